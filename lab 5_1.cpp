@@ -1,20 +1,79 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
+#include <deque>
+#include <memory>
 #include <iomanip>
 #include <algorithm>
 #include <limits>
 #include <sstream>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <string_view>
+#include <charconv>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <mutex>
+#include <shared_mutex>
+#include <atomic>
+#include <thread>
 
 using namespace std;
 
-// Константы склада
-const int ZONES = 1;          // Количество зон (только 'A')
-const int RACKS = 10;         // Стеллажей в зоне
-const int SECTIONS = 7;       // Секций в стеллаже
-const int SHELVES = 4;        // Полок в секции
-const int MAX_ITEMS = 10;     // Максимум товара в ячейке
+// Файл с конфигурацией склада по умолчанию
+const char* DEFAULT_CONFIG = "warehouse.cfg";
+const int MAX_CAPACITY = 65535;   // Предел вместимости ячейки (размер счетчика в Cell)
+const size_t MAX_NAME_LENGTH = 65535;  // Предел длины названия товара (поле длины в журнале)
+
+// Счетчик, который меняется из нескольких потоков без блокировок и читается
+// командой INFO без остановки изменений
+struct SharedCounter {
+    atomic<int> value{0};
+
+    SharedCounter() = default;
+    SharedCounter(const SharedCounter& other) : value(other.get()) {}
+    SharedCounter& operator=(const SharedCounter& other) {
+        value.store(other.get(), memory_order_relaxed);
+        return *this;
+    }
+
+    void add(int delta) { value.fetch_add(delta, memory_order_relaxed); }
+    int get() const { return value.load(memory_order_relaxed); }
+};
+
+// Зона склада: размеры, вместимость ячейки и счетчики загруженности.
+// Ячейки зоны занимают непрерывный участок общего массива warehouse
+struct Zone {
+    char name;
+    int racks;          // Стеллажей в зоне
+    int sections;       // Секций в стеллаже
+    int shelves;        // Полок в секции
+    int capacity;       // Максимум товара в ячейке
+    int firstCell;      // Номер первой ячейки зоны
+    int firstRack;      // Номер первого стеллажа зоны в rackUsedCells
+    int cells;          // Количество ячеек в зоне
+    SharedCounter usedCells;  // Занято ячеек в зоне
+    SharedCounter items;      // Единиц товара в зоне
+};
+
+// Обратный индекс по товару: где лежит и сколько всего
+struct ProductStock {
+    map<int, int> cells;    // Ячейки с этим товаром и количество в каждой
+    set<int> partialCells;  // Те из них, где еще есть свободное место
+    int total = 0;          // Всего единиц товара на складе
+};
 
 // Структура для хранения информации о товаре
 struct ProductInfo {
@@ -22,6 +81,13 @@ struct ProductInfo {
     int quantity;
 };
 
+// Ячейка плотного хранилища: вместо строки хранится номер товара
+// из таблицы интернирования, 0 - ячейка пуста
+struct Cell {
+    uint32_t product = 0;
+    uint16_t quantity = 0;
+};
+
 // Структура адреса ячейки
 struct CellAddress {
     char zone;
@@ -37,215 +103,1860 @@ struct CellAddress {
     }
 };
 
-map<CellAddress, ProductInfo> warehouse;
+// Результат операции над ячейкой
+enum class OpStatus {
+    OK,
+    OVERFLOW,        // превышена вместимость ячейки
+    OTHER_PRODUCT,   // в ячейке другой товар
+    EMPTY,           // ячейка пуста
+    NOT_ENOUGH       // недостаточно товара
+};
+
+// Зоны склада в порядке описания в конфигурации
+vector<Zone> zones;
+
+// Таблица зон по букве: номер зоны в zones или -1
+int zoneByLetter[26];
+
+// Склад - плоский массив ячеек, индексируемый номером ячейки
+vector<Cell> warehouse;
+
+// Номер стеллажа (сквозной по всем зонам) для каждой ячейки
+vector<uint32_t> cellRack;
+
+// Номер зоны для каждого стеллажа
+vector<int> rackZone;
+
+// Счетчики загруженности, обновляемые при каждом изменении ячейки
+int totalCells = 0;                         // Всего ячеек на складе
+SharedCounter usedCells;                    // Занято ячеек на складе
+SharedCounter totalItems;                   // Всего единиц товара
+vector<SharedCounter> rackUsedCells;        // Занято ячеек в каждом стеллаже
+
+// Пустые ячейки: по биту на ячейку (1 - пуста), у каждого стеллажа свои слова.
+// Биты стеллажа меняются под его блокировкой, а читаются без блокировок,
+// поэтому поиск пустой ячейки не мешает изменениям в других стеллажах
+vector<uint32_t> rackFirstWord;             // Первое слово стеллажа в emptyBits
+unique_ptr<atomic<uint64_t>[]> emptyBits;
+
+// Блокировки для одновременной работы нескольких клиентов (режим сервера).
+// Ячейки стеллажа меняются только под его rackLocks, поэтому изменения в разных
+// стеллажах не мешают друг другу. Порядок захвата: стеллаж -> полоса товаров
+// productLocks. productsLock нужна только поиску номера товара по названию
+vector<mutex> rackLocks;                    // По одной на стеллаж
+shared_mutex productsLock;                  // Поиск по названию (новый товар - монопольно)
+const int PRODUCT_STRIPES = 64;
+mutex productLocks[PRODUCT_STRIPES];        // Обратный индекс товара p - под p % PRODUCT_STRIPES
+
+// Разметка склада: zones заполнен, остальные таблицы строятся по нему
+void buildLayout() {
+    fill(begin(zoneByLetter), end(zoneByLetter), -1);
+    totalCells = 0;
+    int totalRacks = 0;
+    for (size_t z = 0; z < zones.size(); z++) {
+        Zone& zone = zones[z];
+        zone.firstCell = totalCells;
+        zone.firstRack = totalRacks;
+        zone.cells = zone.racks * zone.sections * zone.shelves;
+        totalCells += zone.cells;
+        totalRacks += zone.racks;
+        zoneByLetter[zone.name - 'A'] = static_cast<int>(z);
+    }
+
+    warehouse.assign(totalCells, Cell{});
+    cellRack.resize(totalCells);
+    rackZone.resize(totalRacks);
+    rackUsedCells.assign(totalRacks, SharedCounter{});
+    rackLocks = vector<mutex>(totalRacks);
+    rackFirstWord.resize(totalRacks);
+    uint32_t words = 0;
+    for (const Zone& zone : zones) {
+        for (int r = 0; r < zone.racks; r++) {
+            rackFirstWord[zone.firstRack + r] = words;
+            words += (zone.sections * zone.shelves + 63) / 64;
+        }
+    }
+    emptyBits = make_unique<atomic<uint64_t>[]>(words);
+    for (size_t z = 0; z < zones.size(); z++) {
+        const Zone& zone = zones[z];
+        int cellsPerRack = zone.sections * zone.shelves;
+        for (int r = 0; r < zone.racks; r++) {
+            rackZone[zone.firstRack + r] = static_cast<int>(z);
+            fill_n(cellRack.begin() + zone.firstCell + r * cellsPerRack,
+                   cellsPerRack, static_cast<uint32_t>(zone.firstRack + r));
+            // Все ячейки пусты: целые слова - единицами, в последнем - младшие биты
+            for (int i = 0; i < cellsPerRack; i += 64) {
+                int bits = min(64, cellsPerRack - i);
+                emptyBits[rackFirstWord[zone.firstRack + r] + i / 64] =
+                    bits == 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+            }
+        }
+    }
+}
+
+// Загрузка конфигурации склада. Формат - по зоне в строке:
+//   <зона A-Z> <стеллажей> <секций> <полок> <вместимость ячейки>
+// Пустые строки и строки, начинающиеся с '#', пропускаются.
+// Если файла нет, используется стандартный склад: одна зона A 10x7x4 по 10 единиц
+bool loadConfig(const string& path, bool required) {
+    zones.clear();
+    ifstream in(path);
+    if (!in) {
+        if (required) {
+            cout << "Ошибка: не удалось открыть файл конфигурации " << path << "\n";
+            return false;
+        }
+        Zone zone{};
+        zone.name = 'A';
+        zone.racks = 10;
+        zone.sections = 7;
+        zone.shelves = 4;
+        zone.capacity = 10;
+        zones.push_back(zone);
+        buildLayout();
+        return true;
+    }
 
-// Функция для разбора адреса ячейки из строки
-bool parseAddress(const string& addressStr, CellAddress& addr) {
-    char sep;
-    istringstream addrStream(addressStr);
-    if (!(addrStream >> addr.zone >> sep >> addr.rack >> sep >> addr.section >> sep >> addr.shelf) || sep != '-') {
+    bool seen[26] = {};
+    string line;
+    int lineNum = 0;
+    while (getline(in, line)) {
+        lineNum++;
+        istringstream iss(line);
+        string name;
+        if (!(iss >> name) || name[0] == '#') {
+            continue;
+        }
+        Zone zone{};
+        string extra;
+        if (name.size() != 1 || name[0] < 'A' || name[0] > 'Z'
+            || !(iss >> zone.racks >> zone.sections >> zone.shelves >> zone.capacity)
+            || (iss >> extra)
+            || zone.racks <= 0 || zone.sections <= 0 || zone.shelves <= 0
+            || zone.capacity <= 0 || zone.capacity > MAX_CAPACITY) {
+            cout << "Ошибка: неверное описание зоны в " << path << ", строка " << lineNum << "\n";
+            return false;
+        }
+        if (seen[name[0] - 'A']) {
+            cout << "Ошибка: зона " << name << " описана повторно в " << path
+                 << ", строка " << lineNum << "\n";
+            return false;
+        }
+        seen[name[0] - 'A'] = true;
+        zone.name = name[0];
+        zones.push_back(zone);
+    }
+
+    if (zones.empty()) {
+        cout << "Ошибка: в " << path << " не описано ни одной зоны\n";
         return false;
     }
+    buildLayout();
     return true;
 }
 
-// Проверка корректности адреса
-bool isValidAddress(const CellAddress& addr) {
-    return (addr.zone == 'A') && 
-           (addr.rack >= 1 && addr.rack <= RACKS) &&
-           (addr.section >= 1 && addr.section <= SECTIONS) &&
-           (addr.shelf >= 1 && addr.shelf <= SHELVES);
+// Товар из таблицы интернирования: название и обратный индекс
+struct Product {
+    string name;
+    ProductStock stock;
+};
+
+// Таблица товаров по номеру. Номер 0 зарезервирован под пустую ячейку.
+// Записи не перемещаются в памяти; при росте таблица указателей копируется
+// в новую, вдвое большую, и подменяет прежнюю атомарно. Прежние таблицы не
+// освобождаются, поэтому запись по известному номеру берется без блокировок.
+// Новые товары добавляются под монопольной productsLock
+class ProductTable {
+public:
+    ProductTable() { add(""); }
+
+    Product& operator[](uint32_t id) { return *table.load(memory_order_acquire)[id]; }
+
+    // Количество номеров (вместе с нулевым)
+    uint32_t size() const { return count; }
+
+    uint32_t add(const string& name) {
+        if (count == capacity) {
+            capacity = max<uint32_t>(16, capacity * 2);
+            auto grown = make_unique<Product*[]>(capacity);
+            if (!tables.empty()) {
+                copy_n(tables.back().get(), count, grown.get());
+            }
+            tables.push_back(move(grown));
+            table.store(tables.back().get(), memory_order_release);
+        }
+        entries.push_back({name, {}});
+        tables.back()[count] = &entries.back();
+        return count++;
+    }
+
+private:
+    deque<Product> entries;
+    vector<unique_ptr<Product*[]>> tables;
+    atomic<Product**> table{nullptr};
+    uint32_t count = 0;
+    uint32_t capacity = 0;
+};
+
+ProductTable productTable;
+unordered_map<string, uint32_t> productIds;
+
+// Очистка склада с сохранением разметки и таблицы товаров
+void clearStorage() {
+    for (Zone& zone : zones) {
+        zone.usedCells = {};
+        zone.items = {};
+    }
+    usedCells = {};
+    totalItems = {};
+    buildLayout();
+    for (uint32_t p = 0; p < productTable.size(); p++) {
+        productTable[p].stock = ProductStock{};
+    }
 }
 
-// Добавление товара
-void addItems(const string& productName, int quantity, const string& cellAddress) {
+// Переиспользуемый ключ для поиска в productIds: поиск по string_view
+// не выделяет память после того, как буфер ключа вырос до нужного размера
+thread_local string lookupKey;
+
+// Товары, уже найденные этим потоком. Номер товара не меняется, поэтому
+// повторный поиск обходится без productsLock
+thread_local unordered_map<string, uint32_t> knownProducts;
+
+// Поиск номера товара без регистрации (0 - товар неизвестен)
+uint32_t findProduct(string_view name) {
+    lookupKey.assign(name);
+    auto known = knownProducts.find(lookupKey);
+    if (known != knownProducts.end()) {
+        return known->second;
+    }
+    shared_lock<shared_mutex> guard(productsLock);
+    auto it = productIds.find(lookupKey);
+    if (it == productIds.end()) {
+        return 0;
+    }
+    knownProducts.emplace(lookupKey, it->second);
+    return it->second;
+}
+
+// Получение номера товара (новый товар регистрируется)
+uint32_t internProduct(string_view name) {
+    uint32_t known = findProduct(name);
+    if (known != 0) {
+        return known;
+    }
+    unique_lock<shared_mutex> guard(productsLock);
+    auto it = productIds.find(lookupKey);
+    if (it != productIds.end()) {
+        return it->second;
+    }
+    uint32_t id = productTable.add(lookupKey);
+    productIds.emplace(lookupKey, id);
+    knownProducts.emplace(lookupKey, id);
+    return id;
+}
+
+// Зона, которой принадлежит ячейка
+Zone& cellZone(int index) {
+    return zones[rackZone[cellRack[index]]];
+}
+
+// Номер ячейки по адресу (адрес должен быть корректным)
+int cellIndex(const CellAddress& addr) {
+    const Zone& zone = zones[zoneByLetter[addr.zone - 'A']];
+    return zone.firstCell + ((addr.rack - 1) * zone.sections
+            + (addr.section - 1)) * zone.shelves + (addr.shelf - 1);
+}
+
+// Адрес ячейки по её номеру
+CellAddress cellAddress(int index) {
+    const Zone& zone = cellZone(index);
     CellAddress addr;
-    if (!parseAddress(cellAddress, addr)) {
-        cout << "Ошибка: неверный формат адреса ячейки. Используйте формат: A-1-1-1\n";
-        return;
+    addr.zone = zone.name;
+    index -= zone.firstCell;
+    addr.shelf = index % zone.shelves + 1;
+    index /= zone.shelves;
+    addr.section = index % zone.sections + 1;
+    addr.rack = index / zone.sections + 1;
+    return addr;
+}
+
+// Учет изменения количества товара product в ячейке с before на after:
+// счетчики загруженности, биты пустых ячеек и обратный индекс.
+// Вызывается под блокировкой стеллажа ячейки
+void recordChange(int index, uint32_t product, int before, int after) {
+    Zone& zone = cellZone(index);
+    int items = after - before;
+    totalItems.add(items);
+    zone.items.add(items);
+
+    if (before == 0 || after == 0) {
+        int delta = before == 0 ? 1 : -1;
+        uint32_t rack = cellRack[index];
+        usedCells.add(delta);
+        zone.usedCells.add(delta);
+        rackUsedCells[rack].add(delta);
+        int local = (index - zone.firstCell) % (zone.sections * zone.shelves);
+        atomic<uint64_t>& word = emptyBits[rackFirstWord[rack] + local / 64];
+        uint64_t bit = uint64_t{1} << (local % 64);
+        if (before == 0) {
+            word.fetch_and(~bit, memory_order_relaxed);
+        } else {
+            word.fetch_or(bit, memory_order_relaxed);
+        }
     }
 
-    if (!isValidAddress(addr)) {
-        cout << "Ошибка: неверный адрес ячейки\n";
+    lock_guard<mutex> guard(productLocks[product % PRODUCT_STRIPES]);
+    ProductStock& ps = productTable[product].stock;
+    ps.total += items;
+    if (after == 0) {
+        ps.cells.erase(index);
+    } else {
+        ps.cells[index] = after;
+    }
+    if (after != 0 && after < zone.capacity) {
+        ps.partialCells.insert(index);
+    } else {
+        ps.partialCells.erase(index);
+    }
+}
+
+// Можно ли добавить товар в ячейку с состоянием cell
+OpStatus checkAdd(const Cell& cell, uint32_t product, int quantity, int capacity) {
+    // Сравнение через остаток места: сумма с большим quantity переполнила бы int
+    if (quantity > MAX_CAPACITY || quantity > capacity - cell.quantity) {
+        return OpStatus::OVERFLOW;
+    }
+    if (cell.quantity != 0 && cell.product != product) {
+        return OpStatus::OTHER_PRODUCT;
+    }
+    return OpStatus::OK;
+}
+
+// Можно ли забрать товар из ячейки с состоянием cell
+OpStatus checkRemove(const Cell& cell, uint32_t product, int quantity) {
+    if (cell.quantity == 0) {
+        return OpStatus::EMPTY;
+    }
+    if (cell.product != product) {
+        return OpStatus::OTHER_PRODUCT;
+    }
+    if (cell.quantity < quantity) {
+        return OpStatus::NOT_ENOUGH;
+    }
+    return OpStatus::OK;
+}
+
+// Добавление товара в ячейку без вывода сообщений
+OpStatus applyAdd(uint32_t product, int quantity, int index) {
+    Cell& cell = warehouse[index];
+    OpStatus status = checkAdd(cell, product, quantity, cellZone(index).capacity);
+    if (status != OpStatus::OK) {
+        return status;
+    }
+    recordChange(index, product, cell.quantity, cell.quantity + quantity);
+    cell.product = product;
+    cell.quantity += quantity;
+    return OpStatus::OK;
+}
+
+// Удаление товара из ячейки без вывода сообщений
+OpStatus applyRemove(uint32_t product, int quantity, int index) {
+    Cell& cell = warehouse[index];
+    OpStatus status = checkRemove(cell, product, quantity);
+    if (status != OpStatus::OK) {
+        return status;
+    }
+    recordChange(index, product, cell.quantity, cell.quantity - quantity);
+    cell.quantity -= quantity;
+    if (cell.quantity == 0) {
+        cell.product = 0;
+    }
+    return OpStatus::OK;
+}
+
+// Разбор целого числа из всей строки
+bool parseInt(string_view str, int& value) {
+    auto [ptr, ec] = from_chars(str.data(), str.data() + str.size(), value);
+    return ec == errc() && ptr == str.data() + str.size();
+}
+
+// Функция для разбора адреса ячейки из строки вида A-1-1-1
+bool parseAddress(string_view addressStr, CellAddress& addr) {
+    if (addressStr.size() < 2 || addressStr[1] != '-') {
+        return false;
+    }
+    addr.zone = addressStr[0];
+    const char* p = addressStr.data() + 2;
+    const char* end = addressStr.data() + addressStr.size();
+    int* parts[] = {&addr.rack, &addr.section, &addr.shelf};
+    for (int i = 0; i < 3; i++) {
+        auto [next, ec] = from_chars(p, end, *parts[i]);
+        if (ec != errc() || (i < 2 && (next == end || *next != '-'))) {
+            return false;
+        }
+        p = next + (i < 2 ? 1 : 0);
+    }
+    return p == end;
+}
+
+// Проверка корректности адреса: зона ищется в таблице, номера проверяются
+// одним беззнаковым сравнением против размеров этой зоны
+bool isValidAddress(const CellAddress& addr) {
+    unsigned letter = static_cast<unsigned char>(addr.zone) - 'A';
+    if (letter >= 26 || zoneByLetter[letter] < 0) {
+        return false;
+    }
+    const Zone& zone = zones[zoneByLetter[letter]];
+    return static_cast<unsigned>(addr.rack - 1) < static_cast<unsigned>(zone.racks) &&
+           static_cast<unsigned>(addr.section - 1) < static_cast<unsigned>(zone.sections) &&
+           static_cast<unsigned>(addr.shelf - 1) < static_cast<unsigned>(zone.shelves);
+}
+
+// Сохранение состояния: журнал изменений (WAL) и снимки.
+// Каждое успешное ADD/REMOVE дописывается в буфер журнала; буферы пишутся
+// на диск и фиксируются fdatasync группой - когда в них набралось
+// JOURNAL_GROUP записей или когда поток команд опустел (в режиме сервера -
+// перед ответом клиенту, так что одна фиксация покрывает изменения всех
+// клиентов, пришедшие за время предыдущей). Раз в SNAPSHOT_EVERY
+// записей состояние склада сохраняется в снимок, и журнал начинается заново.
+// Снимок и журнал помечены номером поколения: журнал старого поколения
+// (если сбой случился между записью снимка и сбросом журнала) не применяется
+const uint32_t SNAPSHOT_MAGIC = 0x504E5357;   // "WSNP"
+const uint32_t JOURNAL_MAGIC = 0x4C4E4A57;    // "WJNL"
+const size_t JOURNAL_GROUP = 1024;            // Записей в одной групповой фиксации
+const uint64_t SNAPSHOT_EVERY = 200000;       // Записей журнала между снимками
+const int JOURNAL_STRIPES = 64;               // Полос буфера журнала
+
+// Запись журнала. Для 'P' (новый товар) за записью следует название длиной quantity.
+// 'T' открывает транзакцию из cell следующих за ней записей ADD/REMOVE:
+// транзакция, дописанная не полностью, при восстановлении отбрасывается целиком
+struct JournalRecord {
+    uint8_t type;        // 'A' - ADD, 'R' - REMOVE, 'P' - новый товар, 'T' - транзакция
+    uint8_t reserved;
+    uint16_t quantity;   // Для ADD/REMOVE не больше MAX_CAPACITY (проверяет checkCellArgs)
+    uint32_t cell;
+    uint32_t product;
+};
+
+struct JournalHeader {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t generation;
+};
+
+string dataDir;                  // Каталог данных, пусто - сохранение отключено
+int journalFd = -1;
+uint64_t generation = 0;         // Поколение текущих снимка и журнала
+atomic<size_t> pendingRecords{0};       // Записей во всех буферах, ожидающих фиксации
+uint64_t journalRecords = 0;            // Записей в журнале с момента последнего снимка
+atomic<uint32_t> persistedProducts{1};  // Товары с номером меньше уже есть в снимке или журнале
+
+// Изменения ячеек стеллажа r копятся в полосе r % JOURNAL_STRIPES под ее
+// блокировкой, взятой под блокировкой стеллажа, так что порядок записей по
+// каждой ячейке совпадает с порядком изменений, а изменения в разных
+// стеллажах не ждут друг друга.
+// journalBuffer - общий буфер под journalLock: в него при фиксации
+// переносятся полосы, в нем же пишутся товары и транзакции из нескольких
+// полос (перед такой транзакцией ее полосы переносятся в общий буфер).
+// Все записи ячейки в общем буфере идут раньше записей в ее полосе.
+// Порядок захвата: стеллаж -> полосы по возрастанию -> journalLock.
+// journalWriteLock упорядочивает запись на диск и снимки; под блокировкой
+// стеллажа она не берется никогда
+struct JournalBuffer {
+    vector<char> data;
+    size_t records = 0;
+};
+struct alignas(64) JournalStripe {
+    mutex lock;
+    JournalBuffer buffer;
+};
+JournalStripe journalStripes[JOURNAL_STRIPES];
+JournalBuffer journalBuffer;
+mutex journalLock;
+mutex journalWriteLock;
+
+string snapshotPath() { return dataDir + "/warehouse.snap"; }
+string journalPath() { return dataDir + "/warehouse.journal"; }
+
+// Запись всего буфера в файл
+bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Добавление записи в буфер журнала (общий или полосу)
+void appendRecord(JournalBuffer& buffer, const JournalRecord& rec, string_view name = {}) {
+    const char* raw = reinterpret_cast<const char*>(&rec);
+    buffer.data.insert(buffer.data.end(), raw, raw + sizeof(rec));
+    buffer.data.insert(buffer.data.end(), name.begin(), name.end());
+    buffer.records++;
+    pendingRecords.fetch_add(1, memory_order_relaxed);
+}
+
+// Перенос накопленного в полосе в конец общего буфера.
+// Вызывается под блокировками полосы и journalLock
+void drainStripe(JournalStripe& stripe) {
+    journalBuffer.data.insert(journalBuffer.data.end(), stripe.buffer.data.begin(),
+                              stripe.buffer.data.end());
+    journalBuffer.records += stripe.buffer.records;
+    stripe.buffer.data.clear();
+    stripe.buffer.records = 0;
+}
+
+// Открытие нового пустого журнала текущего поколения
+bool startJournal() {
+    if (journalFd >= 0) {
+        close(journalFd);
+    }
+    journalFd = open(journalPath().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    JournalHeader header{JOURNAL_MAGIC, 0, generation};
+    if (journalFd < 0 || !writeAll(journalFd, reinterpret_cast<const char*>(&header), sizeof(header))
+        || fdatasync(journalFd) != 0) {
+        cout << "Ошибка: не удалось создать журнал " << journalPath() << "\n";
+        return false;
+    }
+    journalRecords = 0;
+    return true;
+}
+
+// Сохранение снимка склада: разметка, таблица товаров и занятые ячейки.
+// Снимок пишется во временный файл и атомарно подменяет предыдущий.
+// Вызывается под journalWriteLock; на время записи останавливает изменения
+bool writeSnapshot() {
+    vector<unique_lock<mutex>> racksGuard;
+    for (mutex& m : rackLocks) {
+        racksGuard.emplace_back(m);
+    }
+    shared_lock<shared_mutex> productsGuard(productsLock);
+    lock_guard<mutex> bufferGuard(journalLock);
+
+    string tmpPath = snapshotPath() + ".tmp";
+    FILE* f = fopen(tmpPath.c_str(), "wb");
+    if (f == nullptr) {
+        cout << "Ошибка: не удалось записать снимок " << tmpPath << "\n";
+        return false;
+    }
+    uint64_t nextGeneration = generation + 1;
+    uint32_t zoneCount = static_cast<uint32_t>(zones.size());
+    uint32_t productCount = productTable.size();
+    uint32_t occupied = static_cast<uint32_t>(usedCells.get());
+    fwrite(&SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC), 1, f);
+    fwrite(&nextGeneration, sizeof(nextGeneration), 1, f);
+    fwrite(&zoneCount, sizeof(zoneCount), 1, f);
+    for (const Zone& zone : zones) {
+        int32_t dims[5] = {zone.name, zone.racks, zone.sections, zone.shelves, zone.capacity};
+        fwrite(dims, sizeof(dims), 1, f);
+    }
+    fwrite(&productCount, sizeof(productCount), 1, f);
+    for (uint32_t p = 1; p < productCount; p++) {
+        const string& name = productTable[p].name;
+        uint16_t len = static_cast<uint16_t>(name.size());
+        fwrite(&len, sizeof(len), 1, f);
+        fwrite(name.data(), 1, len, f);
+    }
+    fwrite(&occupied, sizeof(occupied), 1, f);
+    for (int i = 0; i < totalCells; i++) {
+        if (warehouse[i].quantity != 0) {
+            uint32_t cell = static_cast<uint32_t>(i);
+            fwrite(&cell, sizeof(cell), 1, f);
+            fwrite(&warehouse[i].product, sizeof(warehouse[i].product), 1, f);
+            fwrite(&warehouse[i].quantity, sizeof(warehouse[i].quantity), 1, f);
+        }
+    }
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), snapshotPath().c_str()) != 0) {
+        cout << "Ошибка: не удалось записать снимок " << snapshotPath() << "\n";
+        return false;
+    }
+    // Несохраненные записи уже вошли в снимок; полосы под блокировками
+    // стеллажей никто не пополняет
+    journalBuffer = {};
+    for (JournalStripe& stripe : journalStripes) {
+        lock_guard<mutex> stripeGuard(stripe.lock);
+        stripe.buffer = {};
+    }
+    pendingRecords = 0;
+    generation = nextGeneration;
+    persistedProducts = productCount;
+    return startJournal();
+}
+
+// Групповая фиксация: полосы по очереди переносятся в общий буфер, он
+// пишется на диск и фиксируется fdatasync. Пока идет запись, другие потоки
+// продолжают пополнять полосы. При переполнении журнала делается снимок
+void commitJournal() {
+    // journalFd меняется при снимке, поэтому без блокировок проверяется dataDir
+    if (dataDir.empty()) {
         return;
     }
+    lock_guard<mutex> writeGuard(journalWriteLock);
+    JournalBuffer batch;
+    for (JournalStripe& stripe : journalStripes) {
+        lock_guard<mutex> stripeGuard(stripe.lock);
+        if (stripe.buffer.records != 0) {
+            lock_guard<mutex> bufferGuard(journalLock);
+            drainStripe(stripe);
+        }
+    }
+    {
+        lock_guard<mutex> bufferGuard(journalLock);
+        swap(batch, journalBuffer);
+    }
+    // Записи, попавшие в полосы после переноса, уйдут со следующей группой
+    if (batch.records == 0) {
+        return;
+    }
+    pendingRecords.fetch_sub(batch.records, memory_order_relaxed);
+    if (!writeAll(journalFd, batch.data.data(), batch.data.size()) || fdatasync(journalFd) != 0) {
+        cout << "Ошибка: не удалось записать журнал " << journalPath() << "\n";
+    }
+    journalRecords += batch.records;
+    if (journalRecords >= SNAPSHOT_EVERY) {
+        writeSnapshot();
+    }
+}
 
-    if (quantity <= 0) {
-        cout << "Ошибка: количество должно быть положительным\n";
+// Фиксация, если в буфере журнала набралась полная группа записей.
+// Вызывается после снятия блокировки стеллажа
+void commitJournalIfFull() {
+    if (pendingRecords.load(memory_order_relaxed) >= JOURNAL_GROUP) {
+        commitJournal();
+    }
+}
+
+// Запись в общий буфер журнала новых товаров с номерами до product
+// включительно. Товары пишутся по порядку номеров, чтобы при восстановлении
+// номера совпали, и раньше любой записи, которая на них ссылается.
+// Вызывается под journalLock
+void journalProducts(uint32_t product) {
+    uint32_t next = persistedProducts.load(memory_order_relaxed);
+    for (; next <= product; next++) {
+        const string& name = productTable[next].name;
+        appendRecord(journalBuffer, {'P', 0, static_cast<uint16_t>(name.size()), 0, next}, name);
+    }
+    persistedProducts.store(next, memory_order_release);
+}
+
+// Регистрация успешного изменения ячейки в журнале - в полосе ее стеллажа.
+// Вызывается под блокировкой стеллажа ячейки
+void journalMutation(char type, int index, uint32_t product, int quantity) {
+    if (journalFd < 0) {
         return;
     }
+    if (persistedProducts.load(memory_order_acquire) <= product) {
+        lock_guard<mutex> bufferGuard(journalLock);
+        journalProducts(product);
+    }
+    JournalStripe& stripe = journalStripes[cellRack[index] % JOURNAL_STRIPES];
+    lock_guard<mutex> stripeGuard(stripe.lock);
+    appendRecord(stripe.buffer, {static_cast<uint8_t>(type), 0, static_cast<uint16_t>(quantity),
+                                 static_cast<uint32_t>(index), product});
+}
 
-    auto& current = warehouse[addr];
-    
-    if (current.quantity + quantity > MAX_ITEMS) {
-        cout << "Ошибка: превышена вместимость ячейки (макс. " << MAX_ITEMS << ")\n";
-        cout << "Текущее количество: " << current.quantity << "\n";
+// Чтение снимка. Возвращает false, если снимок поврежден или разметка
+// склада в нем не совпадает с текущей конфигурацией
+bool loadSnapshot(FILE* f) {
+    uint32_t magic, zoneCount, productCount, occupied;
+    if (fread(&magic, sizeof(magic), 1, f) != 1 || magic != SNAPSHOT_MAGIC
+        || fread(&generation, sizeof(generation), 1, f) != 1
+        || fread(&zoneCount, sizeof(zoneCount), 1, f) != 1 || zoneCount != zones.size()) {
+        return false;
+    }
+    for (const Zone& zone : zones) {
+        int32_t dims[5];
+        if (fread(dims, sizeof(dims), 1, f) != 1 || dims[0] != zone.name || dims[1] != zone.racks
+            || dims[2] != zone.sections || dims[3] != zone.shelves || dims[4] != zone.capacity) {
+            return false;
+        }
+    }
+    if (fread(&productCount, sizeof(productCount), 1, f) != 1) {
+        return false;
+    }
+    string name;
+    for (uint32_t p = 1; p < productCount; p++) {
+        uint16_t len;
+        if (fread(&len, sizeof(len), 1, f) != 1) {
+            return false;
+        }
+        name.resize(len);
+        if (fread(name.data(), 1, len, f) != len || internProduct(name) != p) {
+            return false;
+        }
+    }
+    if (fread(&occupied, sizeof(occupied), 1, f) != 1) {
+        return false;
+    }
+    for (uint32_t i = 0; i < occupied; i++) {
+        uint32_t cell, product;
+        uint16_t quantity;
+        if (fread(&cell, sizeof(cell), 1, f) != 1 || fread(&product, sizeof(product), 1, f) != 1
+            || fread(&quantity, sizeof(quantity), 1, f) != 1
+            || cell >= static_cast<uint32_t>(totalCells) || product == 0 || product >= productCount
+            || applyAdd(product, quantity, static_cast<int>(cell)) != OpStatus::OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Применение хвоста журнала после снимка. Оборванная последняя запись
+// отбрасывается, в validBytes возвращается длина целой части журнала.
+// Возвращает количество примененных записей или -1, если журнал
+// принадлежит другому поколению
+long long replayJournal(const vector<char>& data, size_t& validBytes) {
+    JournalHeader header;
+    if (data.size() < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if (header.magic != JOURNAL_MAGIC || header.generation != generation) {
+        return -1;
+    }
+    size_t pos = sizeof(header);
+    long long applied = 0;
+    while (pos + sizeof(JournalRecord) <= data.size()) {
+        JournalRecord rec;
+        memcpy(&rec, data.data() + pos, sizeof(rec));
+        size_t next = pos + sizeof(rec) + (rec.type == 'P' ? rec.quantity : 0);
+        // Транзакция применяется, только если все ее записи на месте
+        if (next > data.size()
+            || (rec.type == 'T' && next + size_t{rec.cell} * sizeof(rec) > data.size())) {
+            break;
+        }
+        if (rec.type == 'T') {
+            // Сами изменения идут следующими записями
+        } else if (rec.type == 'P') {
+            internProduct(string_view(data.data() + pos + sizeof(rec), rec.quantity));
+        } else if (rec.cell < static_cast<uint32_t>(totalCells) && rec.product < productTable.size()) {
+            if (rec.type == 'A') {
+                applyAdd(rec.product, rec.quantity, static_cast<int>(rec.cell));
+            } else {
+                applyRemove(rec.product, rec.quantity, static_cast<int>(rec.cell));
+            }
+        }
+        pos = next;
+        applied++;
+    }
+    validBytes = pos;
+    journalRecords = static_cast<uint64_t>(applied);
+    return applied;
+}
+
+// Восстановление состояния из каталога данных: последний снимок и хвост
+// журнала после него. Журнал затем открывается на дозапись
+bool openStorage(const string& dir, bool verbose) {
+    dataDir = dir;
+    mkdir(dataDir.c_str(), 0755);
+
+    FILE* snap = fopen(snapshotPath().c_str(), "rb");
+    bool hasSnapshot = snap != nullptr;
+    if (hasSnapshot) {
+        bool ok = loadSnapshot(snap);
+        fclose(snap);
+        if (!ok) {
+            cout << "Ошибка: снимок " << snapshotPath()
+                 << " поврежден или не соответствует конфигурации склада\n";
+            return false;
+        }
+    }
+
+    vector<char> data;
+    int fd = open(journalPath().c_str(), O_RDONLY);
+    if (fd >= 0) {
+        char chunk[1 << 16];
+        ssize_t got;
+        while ((got = read(fd, chunk, sizeof(chunk))) > 0) {
+            data.insert(data.end(), chunk, chunk + got);
+        }
+        close(fd);
+    }
+    size_t validBytes = 0;
+    long long replayed = replayJournal(data, validBytes);
+    persistedProducts = productTable.size();
+
+    if (replayed < 0) {
+        if (!startJournal()) {
+            return false;
+        }
+        replayed = 0;
     } else {
-        if (current.quantity == 0) {
-            current.name = productName;
-            current.quantity = quantity;
-        } else if (current.name != productName) {
-            cout << "Ошибка: в ячейке уже находится другой товар: " << current.name << "\n";
-            return;
-        } else {
-            current.quantity += quantity;
+        // Дозапись после последней целой записи: оборванный хвост отрезается
+        journalFd = open(journalPath().c_str(), O_WRONLY);
+        if (journalFd < 0 || ftruncate(journalFd, static_cast<off_t>(validBytes)) != 0
+            || lseek(journalFd, 0, SEEK_END) < 0) {
+            cout << "Ошибка: не удалось открыть журнал " << journalPath() << "\n";
+            return false;
         }
-        
-        cout << "Добавлено " << quantity << " единиц товара '" << productName 
-             << "' в ячейку " << cellAddress << "\n";
     }
+
+    if (verbose) {
+        cout << "Состояние восстановлено из " << dataDir << ": "
+             << (hasSnapshot ? "снимок + " : "") << replayed << " записей журнала\n";
+    }
+    return true;
 }
 
-// Удаление товара
-void removeItems(const string& productName, int quantity, const string& cellAddress) {
+// Проверка адреса и количества для ADD/REMOVE/MOVE. Возвращает номер ячейки
+// или -1 (сообщение об ошибке уже выведено)
+int checkCellArgs(string_view cellAddress, int quantity, ostream& out) {
     CellAddress addr;
     if (!parseAddress(cellAddress, addr)) {
-        cout << "Ошибка: неверный формат адреса ячейки. Используйте формат: A-1-1-1\n";
-        return;
+        out << "Ошибка: неверный формат адреса ячейки. Используйте формат: A-1-1-1\n";
+        return -1;
     }
-
     if (!isValidAddress(addr)) {
-        cout << "Ошибка: неверный адрес ячейки\n";
+        out << "Ошибка: неверный адрес ячейки\n";
+        return -1;
+    }
+    if (quantity <= 0) {
+        out << "Ошибка: количество должно быть положительным\n";
+        return -1;
+    }
+    // Количество пишется в журнал 16-битным полем: большее значение
+    // восстановилось бы иначе, чем было применено
+    if (quantity > MAX_CAPACITY) {
+        out << "Ошибка: количество не может превышать " << MAX_CAPACITY << "\n";
+        return -1;
+    }
+    return cellIndex(addr);
+}
+
+// Добавление товара
+void addItems(string_view productName, int quantity, string_view cellAddress, ostream& out) {
+    int index = checkCellArgs(cellAddress, quantity, out);
+    if (index < 0) {
         return;
     }
+    uint32_t product = internProduct(productName);
+    {
+        lock_guard<mutex> rackGuard(rackLocks[cellRack[index]]);
+        const Cell& current = warehouse[index];
 
-    if (quantity <= 0) {
-        cout << "Ошибка: количество должно быть положительным\n";
+        switch (applyAdd(product, quantity, index)) {
+            case OpStatus::OK:
+                journalMutation('A', index, product, quantity);
+                out << "Добавлено " << quantity << " единиц товара '" << productName 
+                    << "' в ячейку " << cellAddress << "\n";
+                break;
+            case OpStatus::OVERFLOW:
+                out << "Ошибка: превышена вместимость ячейки (макс. " << cellZone(index).capacity << ")\n";
+                out << "Текущее количество: " << current.quantity << "\n";
+                break;
+            default:
+                out << "Ошибка: в ячейке уже находится другой товар: " << productTable[current.product].name << "\n";
+                break;
+        }
+    }
+    commitJournalIfFull();
+}
+
+// Удаление товара
+void removeItems(string_view productName, int quantity, string_view cellAddress, ostream& out) {
+    int index = checkCellArgs(cellAddress, quantity, out);
+    if (index < 0) {
         return;
     }
+    uint32_t product = findProduct(productName);
+    {
+        lock_guard<mutex> rackGuard(rackLocks[cellRack[index]]);
+        const Cell& current = warehouse[index];
+        int available = current.quantity;
+
+        switch (applyRemove(product, quantity, index)) {
+            case OpStatus::OK:
+                journalMutation('R', index, product, quantity);
+                out << "Удалено " << quantity << " единиц товара '" << productName 
+                    << "' из ячейки " << cellAddress << "\n";
+                break;
+            case OpStatus::EMPTY:
+                out << "Ошибка: ячейка пуста\n";
+                break;
+            case OpStatus::OTHER_PRODUCT:
+                out << "Ошибка: в ячейке находится другой товар: " << productTable[current.product].name << "\n";
+                break;
+            default:
+                out << "Ошибка: недостаточно товара в ячейке\n";
+                out << "Доступно: " << available << ", запрошено: " << quantity << "\n";
+                break;
+        }
+    }
+    commitJournalIfFull();
+}
+
+// Изменение одной ячейки в составе транзакции
+struct TxOp {
+    bool add;
+    uint32_t product;
+    int quantity;
+    int index;
+};
+
+// Строка ADD/REMOVE, отложенная внутри BEGIN ... COMMIT
+struct TxLine {
+    bool add;
+    string product;
+    int quantity;
+    int index;
+};
+
+// Состояние сеанса (интерактивного, пакетного или клиента сервера):
+// открытая транзакция BEGIN ... COMMIT
+struct Session {
+    bool inTransaction = false;
+    bool failed = false;        // В блоке была строка с ошибкой формата или адреса
+    vector<TxLine> lines;
+};
+
+// Текст причины отказа операции
+const char* statusMessage(OpStatus status) {
+    switch (status) {
+        case OpStatus::OVERFLOW: return "превышена вместимость ячейки";
+        case OpStatus::OTHER_PRODUCT: return "в ячейке находится другой товар";
+        case OpStatus::EMPTY: return "ячейка пуста";
+        case OpStatus::NOT_ENOUGH: return "недостаточно товара в ячейке";
+        default: return "";
+    }
+}
 
-    auto it = warehouse.find(addr);
-    if (it == warehouse.end()) {
-        cout << "Ошибка: ячейка пуста\n";
+// Блокировки всех стеллажей, затронутых транзакцией, в порядке возрастания
+// номеров (так две транзакции не заблокируют друг друга)
+vector<unique_lock<mutex>> lockRacks(const vector<TxOp>& ops) {
+    vector<uint32_t> racks;
+    racks.reserve(ops.size());
+    for (const TxOp& op : ops) {
+        racks.push_back(cellRack[op.index]);
+    }
+    sort(racks.begin(), racks.end());
+    racks.erase(unique(racks.begin(), racks.end()), racks.end());
+    vector<unique_lock<mutex>> guards;
+    guards.reserve(racks.size());
+    for (uint32_t rack : racks) {
+        guards.emplace_back(rackLocks[rack]);
+    }
+    return guards;
+}
+
+// Транзакция: операции сначала проверяются на копиях затронутых ячеек, и
+// только если прошли все, применяются и пишутся в журнал одним блоком.
+// Вызывается под блокировками стеллажей из lockRacks.
+// Возвращает -1 при успехе или номер первой неудачной операции (причина - в status)
+int applyTransaction(const vector<TxOp>& ops, OpStatus& status) {
+    unordered_map<int, Cell> touched;
+    for (size_t i = 0; i < ops.size(); i++) {
+        const TxOp& op = ops[i];
+        Cell& cell = touched.try_emplace(op.index, warehouse[op.index]).first->second;
+        status = op.add ? checkAdd(cell, op.product, op.quantity, cellZone(op.index).capacity)
+                        : checkRemove(cell, op.product, op.quantity);
+        if (status != OpStatus::OK) {
+            return static_cast<int>(i);
+        }
+        cell.product = op.product;
+        cell.quantity += op.add ? op.quantity : -op.quantity;
+        if (cell.quantity == 0) {
+            cell.product = 0;
+        }
+    }
+
+    for (const TxOp& op : ops) {
+        if (op.add) {
+            applyAdd(op.product, op.quantity, op.index);
+        } else {
+            applyRemove(op.product, op.quantity, op.index);
+        }
+    }
+    if (journalFd >= 0) {
+        // Транзакция пишется одним блоком: в полосу, если все ее стеллажи в
+        // одной полосе, иначе в общий буфер после содержимого своих полос
+        vector<int> stripes;
+        for (const TxOp& op : ops) {
+            stripes.push_back(static_cast<int>(cellRack[op.index] % JOURNAL_STRIPES));
+        }
+        sort(stripes.begin(), stripes.end());
+        stripes.erase(unique(stripes.begin(), stripes.end()), stripes.end());
+        vector<unique_lock<mutex>> stripesGuard;
+        for (int s : stripes) {
+            stripesGuard.emplace_back(journalStripes[s].lock);
+        }
+        lock_guard<mutex> bufferGuard(journalLock);
+        for (const TxOp& op : ops) {
+            journalProducts(op.product);
+        }
+        JournalBuffer* target = &journalStripes[stripes[0]].buffer;
+        if (stripes.size() > 1) {
+            for (int s : stripes) {
+                drainStripe(journalStripes[s]);
+            }
+            target = &journalBuffer;
+        }
+        appendRecord(*target, {'T', 0, 0, static_cast<uint32_t>(ops.size()), 0});
+        for (const TxOp& op : ops) {
+            appendRecord(*target, {static_cast<uint8_t>(op.add ? 'A' : 'R'), 0,
+                                   static_cast<uint16_t>(op.quantity), static_cast<uint32_t>(op.index),
+                                   op.product});
+        }
+    }
+    status = OpStatus::OK;
+    return -1;
+}
+
+// Команда MOVE: перенос товара из одной ячейки в другую одной транзакцией
+void moveItems(string_view from, string_view to, int quantity, ostream& out) {
+    int src = checkCellArgs(from, quantity, out);
+    int dst = src < 0 ? -1 : checkCellArgs(to, quantity, out);
+    if (dst < 0) {
         return;
     }
+    vector<TxOp> ops = {{false, 0, quantity, src}, {true, 0, quantity, dst}};
+    {
+        auto racksGuard = lockRacks(ops);
+        uint32_t product = warehouse[src].product;
+        ops[0].product = ops[1].product = product;
+        OpStatus status;
+        int failed = applyTransaction(ops, status);
+        if (failed >= 0) {
+            out << "Ошибка: ячейка " << (failed == 0 ? from : to) << ": " << statusMessage(status) << "\n";
+        } else {
+            out << "Перемещено " << quantity << " единиц товара '" << productTable[product].name
+                << "' из ячейки " << from << " в ячейку " << to << "\n";
+        }
+    }
+    commitJournalIfFull();
+}
 
-    if (it->second.name != productName) {
-        cout << "Ошибка: в ячейке находится другой товар: " << it->second.name << "\n";
+// Команда COMMIT: проверка и применение строк, накопленных после BEGIN.
+// Товары ищутся по одному разу на каждое название в блоке
+void commitTransaction(Session& session, ostream& out) {
+    vector<TxLine> lines;
+    lines.swap(session.lines);
+    session.inTransaction = false;
+    if (session.failed) {
+        out << "Транзакция отменена: в блоке есть строки с ошибками\n";
         return;
     }
 
-    if (it->second.quantity < quantity) {
-        cout << "Ошибка: недостаточно товара в ячейке\n";
-        cout << "Доступно: " << it->second.quantity << ", запрошено: " << quantity << "\n";
+    unordered_map<string_view, uint32_t> products;
+    vector<TxOp> ops;
+    ops.reserve(lines.size());
+    for (const TxLine& line : lines) {
+        auto it = products.find(line.product);
+        if (it == products.end()) {
+            uint32_t id = line.add ? internProduct(line.product) : findProduct(line.product);
+            it = products.emplace(line.product, id).first;
+        }
+        // REMOVE неизвестного товара: номер 0 не совпадет ни с одной ячейкой
+        ops.push_back({line.add, it->second, line.quantity, line.index});
+    }
+
+    {
+        auto racksGuard = lockRacks(ops);
+        OpStatus status;
+        int failed = applyTransaction(ops, status);
+        if (failed >= 0) {
+            const TxLine& line = lines[failed];
+            out << "Ошибка в операции " << failed + 1 << " (" << (line.add ? "ADD " : "REMOVE ")
+                << line.product << " " << line.quantity << "): " << statusMessage(status) << "\n";
+            out << "Транзакция отменена\n";
+        } else {
+            out << "Транзакция выполнена: " << ops.size() << " операций\n";
+        }
+    }
+    commitJournalIfFull();
+}
+
+// Получение сводной информации о складе по накопленным счетчикам.
+// Счетчики читаются без блокировок, изменения при этом не останавливаются
+void showInfo(ostream& out) {
+    int used = usedCells.get();
+    out << "\nОБЩАЯ ИНФОРМАЦИЯ\n";
+    out << "Загруженность склада: " 
+        << fixed << setprecision(2) 
+        << (used * 100.0 / totalCells) << "%\n";
+    out << "Занято ячеек: " << used << " из " << totalCells << "\n";
+    out << "Всего товара: " << totalItems.get() << " единиц\n";
+
+    out << "\nЗАГРУЖЕННОСТЬ ЗОН\n";
+    for (const Zone& zone : zones) {
+        int zoneUsed = zone.usedCells.get();
+        out << "Зона " << zone.name << ": " 
+            << fixed << setprecision(2) 
+            << (zoneUsed * 100.0 / zone.cells) << "% ("
+            << zoneUsed << " из " << zone.cells << " ячеек, "
+            << zone.items.get() << " единиц)\n";
+    }
+
+    out << "\nЗАГРУЖЕННОСТЬ СТЕЛЛАЖЕЙ\n";
+    for (const Zone& zone : zones) {
+        for (int r = 0; r < zone.racks; r++) {
+            out << zone.name << "-" << r + 1 << ": " 
+                << fixed << setprecision(2) 
+                << (rackUsedCells[zone.firstRack + r].get() * 100.0 / (zone.sections * zone.shelves)) << "%\n";
+        }
+    }
+}
+
+// Вывод адреса ячейки в поток
+void printAddress(const CellAddress& addr, ostream& out) {
+    out << addr.zone << "-" << addr.rack << "-" 
+        << addr.section << "-" << addr.shelf;
+}
+
+// Поячеечный список занятых или пустых ячеек (выводится по мере обхода,
+// каждый стеллаж - под своей блокировкой)
+void listCells(bool occupied, ostream& out) {
+    for (const Zone& zone : zones) {
+        int cellsPerRack = zone.sections * zone.shelves;
+        for (int r = 0; r < zone.racks; r++) {
+            lock_guard<mutex> rackGuard(rackLocks[zone.firstRack + r]);
+            int first = zone.firstCell + r * cellsPerRack;
+            for (int i = first; i < first + cellsPerRack; i++) {
+                const Cell& cell = warehouse[i];
+                if ((cell.quantity != 0) != occupied) {
+                    continue;
+                }
+                printAddress(cellAddress(i), out);
+                if (occupied) {
+                    out << ": " << productTable[cell.product].name << ", " << cell.quantity << " ед.";
+                }
+                out << "\n";
+            }
+        }
+    }
+}
+
+// Список занятых и пустых ячеек
+void showCells(ostream& out) {
+    out << "\nЗАНЯТЫЕ ЯЧЕЙКИ\n";
+    if (usedCells.get() == 0) {
+        out << "Нет занятых ячеек\n";
     } else {
-        it->second.quantity -= quantity;
-        cout << "Удалено " << quantity << " единиц товара '" << productName 
-             << "' из ячейки " << cellAddress << "\n";
-        
-        if (it->second.quantity == 0) {
-            warehouse.erase(it);
-        }
-    }
-}
-
-// Получение информации о складе
-void showInfo() {
-    const int totalCells = ZONES * RACKS * SECTIONS * SHELVES;
-    int usedCells = 0;
-    int totalItems = 0;
-    vector<pair<CellAddress, ProductInfo>> occupiedCells;
-    vector<CellAddress> emptyCells;
-
-    // Сбор статистики
-    for (int r = 1; r <= RACKS; r++) {
-        for (int s = 1; s <= SECTIONS; s++) {
-            for (int sh = 1; sh <= SHELVES; sh++) {
-                CellAddress addr{'A', r, s, sh};
-                auto it = warehouse.find(addr);
-                
-                if (it != warehouse.end()) {
-                    usedCells++;
-                    totalItems += it->second.quantity;
-                    occupiedCells.emplace_back(*it);
-                } else {
-                    emptyCells.push_back(addr);
+        listCells(true, out);
+    }
+
+    out << "\nПУСТЫЕ ЯЧЕЙКИ\n";
+    if (usedCells.get() == totalCells) {
+        out << "Нет пустых ячеек\n";
+    } else {
+        listCells(false, out);
+    }
+}
+
+// Ближайшая ячейка, куда можно положить quantity единиц товара: сначала ячейки,
+// где этот товар уже лежит, затем пустые. Ближе - меньший номер ячейки
+// (порядок зон в конфигурации, затем стеллаж, секция, полка). -1 - места нет.
+// В free возвращается свободное место в ячейке
+int suggestPutaway(uint32_t product, int quantity, int& free) {
+    if (product != 0) {
+        lock_guard<mutex> guard(productLocks[product % PRODUCT_STRIPES]);
+        const ProductStock& ps = productTable[product].stock;
+        for (int index : ps.partialCells) {
+            free = cellZone(index).capacity - ps.cells.at(index);
+            if (free >= quantity) {
+                return index;
+            }
+        }
+    }
+    // Пустые ячейки ищутся по битам без блокировок; заполненные стеллажи
+    // пропускаются по счетчикам
+    for (const Zone& zone : zones) {
+        if (zone.capacity < quantity) {
+            continue;
+        }
+        int cellsPerRack = zone.sections * zone.shelves;
+        for (int r = 0; r < zone.racks; r++) {
+            int rack = zone.firstRack + r;
+            if (rackUsedCells[rack].get() == cellsPerRack) {
+                continue;
+            }
+            for (int w = 0; w * 64 < cellsPerRack; w++) {
+                uint64_t bits = emptyBits[rackFirstWord[rack] + w].load(memory_order_relaxed);
+                if (bits != 0) {
+                    free = zone.capacity;
+                    return zone.firstCell + r * cellsPerRack + w * 64 + __builtin_ctzll(bits);
                 }
             }
         }
     }
+    return -1;
+}
 
-    // Вывод информации
-    cout << "\nОБЩАЯ ИНФОРМАЦИЯ\n";
-    cout << "Загруженность склада: " 
-         << fixed << setprecision(2) 
-         << (usedCells * 100.0 / totalCells) << "%\n";
-    cout << "Занято ячеек: " << usedCells << " из " << totalCells << "\n";
-    cout << "Всего товара: " << totalItems << " единиц\n";
+// Команда FIND: ячейки, в которых лежит товар
+void showLocations(string_view productName, ostream& out) {
+    uint32_t product = findProduct(productName);
+    lock_guard<mutex> guard(productLocks[product % PRODUCT_STRIPES]);
+    const ProductStock& ps = productTable[product].stock;
+    if (product == 0 || ps.cells.empty()) {
+        out << "Товар '" << productName << "' на складе не найден\n";
+        return;
+    }
+    out << "Товар '" << productName << "' находится в ячейках:\n";
+    for (const auto& [index, quantity] : ps.cells) {
+        printAddress(cellAddress(index), out);
+        out << ": " << quantity << " ед.\n";
+    }
+}
 
-    cout << "\nЗАГРУЖЕННОСТЬ ЗОН\n";
-    cout << "Зона A: " 
-         << fixed << setprecision(2) 
-         << (usedCells * 100.0 / totalCells) << "%\n";
+// Команда STOCK: общий остаток товара
+void showStock(string_view productName, ostream& out) {
+    uint32_t product = findProduct(productName);
+    int total = 0;
+    int cells = 0;
+    if (product != 0) {
+        lock_guard<mutex> guard(productLocks[product % PRODUCT_STRIPES]);
+        const ProductStock& ps = productTable[product].stock;
+        total = ps.total;
+        cells = static_cast<int>(ps.cells.size());
+    }
+    out << "Товар '" << productName << "': " << total << " единиц в " << cells << " ячейках\n";
+}
 
-    cout << "\nЗАНЯТЫЕ ЯЧЕЙКИ\n";
-    if (occupiedCells.empty()) {
-        cout << "Нет занятых ячеек\n";
-    } else {
-        for (const auto& [addr, product] : occupiedCells) {
-            cout << addr.zone << "-" << addr.rack << "-" 
-                 << addr.section << "-" << addr.shelf 
-                 << ": " << product.name << ", " << product.quantity << " ед.\n";
+// Команда PUTAWAY: рекомендация ячейки для размещения товара
+void showPutaway(string_view productName, int quantity, ostream& out) {
+    if (quantity <= 0) {
+        out << "Ошибка: количество должно быть положительным\n";
+        return;
+    }
+    int free = 0;
+    int index = suggestPutaway(findProduct(productName), quantity, free);
+    if (index < 0) {
+        out << "Нет ячейки, куда можно разместить " << quantity << " единиц товара '"
+            << productName << "'\n";
+        return;
+    }
+    out << "Разместить товар '" << productName << "' в ячейку ";
+    printAddress(cellAddress(index), out);
+    out << " (свободно " << free << ")\n";
+}
+
+// Операция для бенчмарка
+struct BenchOp {
+    bool add;
+    uint32_t product;
+    int quantity;
+    int index;
+};
+
+// Сравнение плотного массива ячеек с прежним map<CellAddress, ProductInfo>
+// на смешанном потоке операций ADD/REMOVE
+void runBenchmark(int operations) {
+    const int PRODUCTS = 64;
+    mt19937 rng(12345);
+    uniform_int_distribution<int> cellDist(0, totalCells - 1);
+    uniform_int_distribution<int> productDist(1, PRODUCTS);
+    uniform_int_distribution<int> quantityDist(1, max(1, zones[0].capacity / 2));
+
+    for (int p = 1; p <= PRODUCTS; p++) {
+        internProduct("Товар" + to_string(p));
+    }
+    vector<BenchOp> ops(operations);
+    for (auto& op : ops) {
+        op.add = rng() % 2 == 0;
+        op.index = cellDist(rng);
+        // За ячейкой закреплен один товар, изредка списывают чужой
+        op.product = op.add || rng() % 10 != 0 ? op.index % PRODUCTS + 1 : productDist(rng);
+        op.quantity = quantityDist(rng);
+    }
+
+    // Прежняя реализация: дерево с ключом-адресом и строкой в значении
+    map<CellAddress, ProductInfo> tree;
+    long long treeOk = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto& op : ops) {
+        CellAddress addr = cellAddress(op.index);
+        const string& name = productTable[op.product].name;
+        if (op.add) {
+            auto& current = tree[addr];
+            if (current.quantity + op.quantity > cellZone(op.index).capacity) continue;
+            if (current.quantity == 0) {
+                current.name = name;
+                current.quantity = op.quantity;
+            } else if (current.name != name) {
+                continue;
+            } else {
+                current.quantity += op.quantity;
+            }
+            treeOk++;
+        } else {
+            auto it = tree.find(addr);
+            if (it == tree.end() || it->second.name != name || it->second.quantity < op.quantity) continue;
+            it->second.quantity -= op.quantity;
+            if (it->second.quantity == 0) tree.erase(it);
+            treeOk++;
         }
     }
+    double treeSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
-    cout << "\nПУСТЫЕ ЯЧЕЙКИ\n";
-    if (emptyCells.empty()) {
-        cout << "Нет пустых ячеек\n";
-    } else {
-        for (const auto& addr : emptyCells) {
-            cout << addr.zone << "-" << addr.rack << "-" 
-                 << addr.section << "-" << addr.shelf << "\n";
+    // Новая реализация: плотный массив ячеек
+    long long denseOk = 0;
+    start = chrono::steady_clock::now();
+    for (const auto& op : ops) {
+        OpStatus status = op.add ? applyAdd(op.product, op.quantity, op.index)
+                                 : applyRemove(op.product, op.quantity, op.index);
+        if (status == OpStatus::OK) denseOk++;
+    }
+    double denseSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Операций: " << operations << ", ячеек: " << totalCells << "\n";
+    cout << fixed << setprecision(3);
+    cout << "map<CellAddress, ProductInfo>: " << treeSec * 1000 << " мс ("
+         << treeOk << " успешных)\n";
+    cout << "Массив ячеек:                  " << denseSec * 1000 << " мс ("
+         << denseOk << " успешных)\n";
+    cout << "Ускорение: " << setprecision(2) << treeSec / denseSec << "x\n";
+}
+
+// Выделение очередного слова строки: пробелы и табуляции пропускаются
+string_view nextToken(string_view& line) {
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == string_view::npos) {
+        line = {};
+        return {};
+    }
+    size_t end = line.find_first_of(" \t\r", start);
+    if (end == string_view::npos) {
+        end = line.size();
+    }
+    string_view token = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return token;
+}
+
+// Разбор аргументов ADD/REMOVE: <товар> <количество> <адрес>
+bool parseItemArgs(string_view& line, string_view& productName, int& quantity, string_view& cellAddress) {
+    productName = nextToken(line);
+    string_view quantityStr = nextToken(line);
+    cellAddress = nextToken(line);
+    return !cellAddress.empty() && productName.size() <= MAX_NAME_LENGTH && parseInt(quantityStr, quantity);
+}
+
+// Выполнение одной строки команды, ответ пишется в out.
+// Возвращает false на команде EXIT
+bool executeLine(string_view line, Session& session, ostream& out) {
+    string_view command = nextToken(line);
+
+    // Внутри BEGIN ... COMMIT строки ADD/REMOVE только проверяются и копятся
+    if (session.inTransaction && (command == "ADD" || command == "REMOVE")) {
+        string_view productName, cellAddress;
+        int quantity;
+        int index = -1;
+        if (!parseItemArgs(line, productName, quantity, cellAddress)) {
+            out << "Ошибка: неверный формат команды. Пример: " << command << " Апельсины 8 A-1-1-1\n";
+        } else {
+            index = checkCellArgs(cellAddress, quantity, out);
+        }
+        if (index < 0) {
+            session.failed = true;
+        } else {
+            session.lines.push_back({command == "ADD", string(productName), quantity, index});
+        }
+    }
+    else if (command == "COMMIT" || command == "ROLLBACK") {
+        if (!session.inTransaction) {
+            out << "Ошибка: транзакция не начата (BEGIN)\n";
+        } else if (command == "COMMIT") {
+            commitTransaction(session, out);
+        } else {
+            session = Session{};
+            out << "Транзакция отменена\n";
+        }
+    }
+    else if (session.inTransaction && !command.empty() && command != "EXIT") {
+        out << "Ошибка: внутри транзакции допустимы только ADD и REMOVE, завершение - COMMIT или ROLLBACK\n";
+    }
+    else if (command == "BEGIN") {
+        session.inTransaction = true;
+        session.failed = false;
+        session.lines.clear();
+    }
+    else if (command == "MOVE") {
+        string_view from = nextToken(line);
+        string_view to = nextToken(line);
+        int quantity;
+        if (to.empty() || !parseInt(nextToken(line), quantity)) {
+            out << "Ошибка: неверный формат команды. Пример: MOVE A-1-1-1 A-2-1-1 5\n";
+        } else {
+            moveItems(from, to, quantity, out);
+        }
+    }
+    else if (command == "ADD" || command == "REMOVE") {
+        string_view productName, cellAddress;
+        int quantity;
+        if (!parseItemArgs(line, productName, quantity, cellAddress)) {
+            out << "Ошибка: неверный формат команды. Пример: " << command << " Апельсины 8 A-1-1-1\n";
+        } else if (command == "ADD") {
+            addItems(productName, quantity, cellAddress, out);
+        } else {
+            removeItems(productName, quantity, cellAddress, out);
         }
     }
+    else if (command == "INFO") {
+        showInfo(out);
+    }
+    else if (command == "CELLS") {
+        showCells(out);
+    }
+    else if (command == "FIND" || command == "STOCK") {
+        string_view productName = nextToken(line);
+        if (productName.empty()) {
+            out << "Ошибка: неверный формат команды. Пример: " << command << " Апельсины\n";
+        } else if (command == "FIND") {
+            showLocations(productName, out);
+        } else {
+            showStock(productName, out);
+        }
+    }
+    else if (command == "PUTAWAY") {
+        string_view productName = nextToken(line);
+        string_view quantityStr = nextToken(line);
+        int quantity = 1;
+        if (productName.empty() || (!quantityStr.empty() && !parseInt(quantityStr, quantity))) {
+            out << "Ошибка: неверный формат команды. Пример: PUTAWAY Апельсины 8\n";
+        } else {
+            showPutaway(productName, quantity, out);
+        }
+    }
+    else if (command == "SNAPSHOT") {
+        if (journalFd < 0) {
+            out << "Ошибка: сохранение состояния не включено (параметр --data)\n";
+        } else {
+            commitJournal();
+            lock_guard<mutex> writeGuard(journalWriteLock);
+            if (writeSnapshot()) {
+                out << "Снимок склада сохранен\n";
+            }
+        }
+    }
+    else if (command == "EXIT") {
+        return false;
+    }
+    else if (!command.empty()) {
+        out << "Неизвестная команда\n";
+    }
+    return true;
 }
 
-int main() {
-    cout << "СИСТЕМА УЧЕТА ТОВАРОВ\n";
-    cout << "Доступные команды:\n"
-         << "ADD <название товара> <количество> <адрес ячейки (A-1-1-1)>\n"
-         << "REMOVE <название товара> <количество> <адрес ячейки (A-1-1-1)>\n"
-         << "INFO - информация о складе\n"
-         << "EXIT - выход\n";
+// Пакетный режим: без приглашений, ввод читается крупными блоками и
+// разбирается на месте, вывод копится в буфере cout и сбрасывается целиком
+void runBatch(FILE* in) {
+    Session session;
+    const size_t CHUNK = 1 << 16;
+    vector<char> buffer(CHUNK);
+    size_t filled = 0;   // Байт в буфере, включая неразобранный хвост
+    while (true) {
+        size_t got = fread(buffer.data() + filled, 1, buffer.size() - filled, in);
+        filled += got;
+        bool eof = got == 0;
+
+        // Разбор всех полных строк в буфере
+        size_t pos = 0;
+        while (true) {
+            const char* begin = buffer.data() + pos;
+            const char* nl = static_cast<const char*>(memchr(begin, '\n', filled - pos));
+            if (nl == nullptr) {
+                if (!eof || pos == filled) break;
+                nl = buffer.data() + filled;   // Последняя строка без перевода строки
+            }
+            if (!executeLine(string_view(begin, nl - begin), session, cout)) {
+                return;
+            }
+            pos = min(filled, static_cast<size_t>(nl - buffer.data()) + 1);
+        }
+        if (eof) {
+            return;
+        }
+        commitJournal();
+
+        // Хвост неполной строки переносится в начало; строка длиннее буфера
+        // увеличивает его
+        memmove(buffer.data(), buffer.data() + pos, filled - pos);
+        filled -= pos;
+        if (filled == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+    }
+}
 
+// Интерактивный цикл: перед каждой командой фиксируется журнал и выводится
+// приглашение. Для cin, связанного с cout, вывод сбрасывается перед чтением
+// каждой строки; бенчмарк связывает так же свои потоки
+void runInteractive(istream& in, ostream& out) {
+    Session session;
     string line;
     while (true) {
-        cout << "\n> ";
-        getline(cin, line);
-        istringstream iss(line);
-        string command;
-        iss >> command;
-
-        if (command == "ADD") {
-            string productName, cellAddress;
-            int quantity;
-            
-            if (!(iss >> productName >> quantity >> cellAddress)) {
-                cout << "Ошибка: неверный формат команды. Пример: ADD Апельсины 8 A-1-1-1\n";
-                continue;
-            }
-            addItems(productName, quantity, cellAddress);
+        // Пока оператор набирает команду, накопленные изменения фиксируются
+        commitJournal();
+        out << "\n> ";
+        if (!getline(in, line) || !executeLine(line, session, out)) {
+            break;
         }
-        else if (command == "REMOVE") {
-            string productName, cellAddress;
-            int quantity;
-            
-            if (!(iss >> productName >> quantity >> cellAddress)) {
-                cout << "Ошибка: неверный формат команды. Пример: REMOVE Апельсины 8 A-1-1-1\n";
-                continue;
-            }
-            removeItems(productName, quantity, cellAddress);
+    }
+    commitJournal();
+}
+
+// Сравнение пропускной способности (строк в секунду) интерактивного цикла
+// и пакетного режима на одном и том же потоке команд. Оба пишут в
+// /dev/null: интерактивный цикл сбрасывает вывод перед каждой строкой,
+// пакетный - крупными блоками
+void runBatchBenchmark(int lines) {
+    mt19937 rng(777);
+    uniform_int_distribution<int> cellDist(0, totalCells - 1);
+    uniform_int_distribution<int> quantityDist(1, max(1, zones[0].capacity / 2));
+    string input;
+    for (int i = 0; i < lines; i++) {
+        int index = cellDist(rng);
+        CellAddress addr = cellAddress(index);
+        input += rng() % 2 == 0 ? "ADD " : "REMOVE ";
+        input += "Товар" + to_string(index % 64) + " " + to_string(quantityDist(rng)) + " ";
+        input += string(1, addr.zone) + "-" + to_string(addr.rack) + "-"
+                 + to_string(addr.section) + "-" + to_string(addr.shelf) + "\n";
+    }
+
+    // Интерактивный цикл: строки по одной через getline, вход связан с
+    // выводом, как cin с cout
+    ofstream loopOut("/dev/null");
+    istringstream in(input);
+    in.tie(&loopOut);
+    clearStorage();
+    auto start = chrono::steady_clock::now();
+    runInteractive(in, loopOut);
+    loopOut.flush();
+    double loopSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Пакетный режим: ввод читается из того же текста блоками, вывод
+    // копится в буфере cout
+    static char outBuffer[1 << 20];
+    ofstream batchOut;
+    batchOut.rdbuf()->pubsetbuf(outBuffer, sizeof(outBuffer));
+    batchOut.open("/dev/null");
+    streambuf* saved = cout.rdbuf(batchOut.rdbuf());
+    clearStorage();
+    FILE* batchIn = fmemopen(input.data(), input.size(), "r");
+    start = chrono::steady_clock::now();
+    runBatch(batchIn);
+    cout.flush();
+    double batchSec = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    fclose(batchIn);
+    cout.rdbuf(saved);
+
+    cout << "Строк: " << lines << "\n";
+    cout << fixed << setprecision(0);
+    cout << "Интерактивный цикл (getline, сброс на строку): " << lines / loopSec << " строк/с\n";
+    cout << "Пакетный режим:                                " << lines / batchSec << " строк/с\n";
+    cout << "Ускорение: " << setprecision(2) << loopSec / batchSec << "x\n";
+}
+
+// Открытие TCP-сокета на 127.0.0.1:port (0 - любой свободный порт).
+// Возвращает дескриптор или -1, фактический порт - в port
+int openListener(int& port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 128) != 0
+        || getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+        close(fd);
+        return -1;
+    }
+    port = ntohs(addr.sin_port);
+    return fd;
+}
+
+// Отправка всего буфера в сокет
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
         }
-        else if (command == "INFO") {
-            showInfo();
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Обслуживание одного клиента. Протокол тот же, что в интерактивном режиме:
+// строка команды - ответ, после которого идет приглашение "> ".
+// Все команды, пришедшие одним пакетом, фиксируются в журнале одной группой
+// до отправки ответов
+void serveClient(int fd) {
+    Session session;
+    string pending;
+    string reply = "> ";
+    ostringstream out;
+    char buf[1 << 14];
+    bool open = sendAll(fd, reply.data(), reply.size());
+    while (open) {
+        ssize_t got = recv(fd, buf, sizeof(buf), 0);
+        if (got <= 0) {
+            break;
+        }
+        pending.append(buf, static_cast<size_t>(got));
+
+        reply.clear();
+        size_t pos = 0;
+        size_t nl;
+        while (open && (nl = pending.find('\n', pos)) != string::npos) {
+            out.str("");
+            open = executeLine(string_view(pending).substr(pos, nl - pos), session, out);
+            reply += out.str();
+            reply += "> ";
+            pos = nl + 1;
         }
-        else if (command == "EXIT") {
+        pending.erase(0, pos);
+        commitJournal();
+        open = sendAll(fd, reply.data(), reply.size()) && open;
+    }
+    close(fd);
+}
+
+// Режим сервера: каждый клиент обслуживается в своем потоке
+int runServer(int port) {
+    int listener = openListener(port);
+    if (listener < 0) {
+        cout << "Ошибка: не удалось открыть порт " << port << "\n";
+        return 1;
+    }
+    cout << "Сервер склада слушает 127.0.0.1:" << port << endl;
+    while (true) {
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) continue;
             break;
         }
-        else if (!command.empty()) {
-            cout << "Неизвестная команда\n";
+        thread(serveClient, client).detach();
+    }
+    close(listener);
+    return 0;
+}
+
+// Нагрузочный тест сервера: поднимает сервер на свободном порту и гоняет через
+// него ADD/REMOVE из 1, 2, 4, ... maxThreads клиентских потоков. Каждый клиент
+// работает в основном со своими стеллажами. Выводит пропускную способность
+// и 99-й перцентиль задержки ответа
+void runServerBenchmark(int maxThreads, int opsPerThread) {
+    int port = 0;
+    int listener = openListener(port);
+    if (listener < 0) {
+        cout << "Ошибка: не удалось открыть порт для сервера\n";
+        return;
+    }
+    thread([listener] {
+        int client;
+        while ((client = accept(listener, nullptr, nullptr)) >= 0) {
+            thread(serveClient, client).detach();
+        }
+    }).detach();
+
+    int totalRacks = static_cast<int>(rackZone.size());
+    cout << "Клиентов  Операций/с   p99, мкс\n";
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        vector<vector<double>> latencies(threads);
+        vector<thread> clients;
+        auto start = chrono::steady_clock::now();
+        for (int t = 0; t < threads; t++) {
+            clients.emplace_back([&, t] {
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                sockaddr_in addr{};
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                addr.sin_port = htons(static_cast<uint16_t>(port));
+                if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                    close(fd);
+                    return;
+                }
+                mt19937 rng(1000 + t);
+                string reply;
+                char buf[4096];
+                // Чтение ответа до приглашения "> "
+                auto readReply = [&] {
+                    reply.clear();
+                    while (reply.size() < 2 || reply.compare(reply.size() - 2, 2, "> ") != 0) {
+                        ssize_t got = recv(fd, buf, sizeof(buf), 0);
+                        if (got <= 0) return false;
+                        reply.append(buf, static_cast<size_t>(got));
+                    }
+                    return true;
+                };
+                readReply();
+                latencies[t].reserve(opsPerThread);
+                for (int i = 0; i < opsPerThread; i++) {
+                    // Свой стеллаж, изредка - случайный
+                    int rack = static_cast<int>((rng() % 8 == 0 ? rng() : t) % totalRacks);
+                    const Zone& zone = zones[rackZone[rack]];
+                    int cellsPerRack = zone.sections * zone.shelves;
+                    int index = zone.firstCell + (rack - zone.firstRack) * cellsPerRack
+                                + static_cast<int>(rng() % cellsPerRack);
+                    CellAddress a = cellAddress(index);
+                    string line = (rng() % 2 == 0 ? "ADD P" : "REMOVE P") + to_string(index % 16) + " "
+                                  + to_string(1 + rng() % max(1, zone.capacity / 2)) + " "
+                                  + a.zone + "-" + to_string(a.rack) + "-" + to_string(a.section)
+                                  + "-" + to_string(a.shelf) + "\n";
+                    auto sent = chrono::steady_clock::now();
+                    if (!sendAll(fd, line.data(), line.size()) || !readReply()) {
+                        break;
+                    }
+                    latencies[t].push_back(
+                        chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+                }
+                close(fd);
+            });
+        }
+        for (thread& c : clients) {
+            c.join();
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<double> all;
+        for (const auto& l : latencies) {
+            all.insert(all.end(), l.begin(), l.end());
+        }
+        if (all.empty()) {
+            cout << "Ошибка: клиенты не смогли подключиться к серверу\n";
+            break;
         }
+        size_t p99 = all.size() * 99 / 100;
+        nth_element(all.begin(), all.begin() + p99, all.end());
+        cout << setw(8) << threads << "  " << setw(10) << fixed << setprecision(0)
+             << all.size() / seconds << "  " << setw(9) << setprecision(1) << all[p99] << "\n";
     }
+    close(listener);
+}
 
+int main(int argc, char* argv[]) {
+    // Параметры запуска: lab5_1 [--config <файл>] [--data <каталог>] [--batch] [--server <порт>]
+    //                           [--bench [количество операций]] [--bench-batch [количество строк]]
+    //                           [--bench-server [клиентов] [операций на клиента]]
+    string configPath = DEFAULT_CONFIG;
+    string dataPath;
+    bool configRequired = false;
+    bool bench = false;
+    bool benchBatch = false;
+    bool batch = false;
+    bool benchServer = false;
+    int serverPort = -1;
+    int benchOperations = 4000000;
+    int benchLines = 2000000;
+    int benchClients = 8;
+    int benchClientOps = 20000;
+    for (int i = 1; i < argc; i++) {
+        bool hasNumber = i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0]));
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            configPath = argv[++i];
+            configRequired = true;
+        } else if (strcmp(argv[i], "--data") == 0 && i + 1 < argc) {
+            dataPath = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--server") == 0 && hasNumber) {
+            serverPort = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench-server") == 0) {
+            benchServer = true;
+            if (hasNumber) {
+                benchClients = atoi(argv[++i]);
+            }
+            if (i + 1 < argc && isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                benchClientOps = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+            if (hasNumber) {
+                benchOperations = atoi(argv[++i]);
+            }
+        } else if (strcmp(argv[i], "--bench-batch") == 0) {
+            benchBatch = true;
+            if (hasNumber) {
+                benchLines = atoi(argv[++i]);
+            }
+        }
+    }
+
+    if (!loadConfig(configPath, configRequired)) {
+        return 1;
+    }
+
+    if (bench) {
+        runBenchmark(benchOperations);
+        return 0;
+    }
+    if (benchBatch) {
+        runBatchBenchmark(benchLines);
+        return 0;
+    }
+
+    // Бенчмарк сервера не пишет в рабочий каталог данных: с --data журнал
+    // ведется во временном каталоге, который после замера удаляется
+    if (benchServer) {
+        string benchDir;
+        if (!dataPath.empty()) {
+            char dirTemplate[] = "/tmp/warehouse-bench-XXXXXX";
+            if (mkdtemp(dirTemplate) == nullptr) {
+                cout << "Ошибка: не удалось создать временный каталог для бенчмарка\n";
+                return 1;
+            }
+            benchDir = dirTemplate;
+            if (!openStorage(benchDir, false)) {
+                return 1;
+            }
+        }
+        runServerBenchmark(benchClients, benchClientOps);
+        commitJournal();
+        if (!benchDir.empty()) {
+            remove(journalPath().c_str());
+            remove(snapshotPath().c_str());
+            rmdir(benchDir.c_str());
+        }
+        return 0;
+    }
+
+    if (!dataPath.empty() && !openStorage(dataPath, !batch)) {
+        return 1;
+    }
+    if (serverPort >= 0) {
+        return runServer(serverPort);
+    }
+
+    if (batch) {
+        static char outBuffer[1 << 20];
+        ios::sync_with_stdio(false);
+        cout.rdbuf()->pubsetbuf(outBuffer, sizeof(outBuffer));
+        runBatch(stdin);
+        commitJournal();
+        cout.flush();
+        return 0;
+    }
+
+    cout << "СИСТЕМА УЧЕТА ТОВАРОВ\n";
+    cout << "Доступные команды:\n"
+         << "ADD <название товара> <количество> <адрес ячейки (A-1-1-1)>\n"
+         << "REMOVE <название товара> <количество> <адрес ячейки (A-1-1-1)>\n"
+         << "INFO - информация о складе\n"
+         << "CELLS - список занятых и пустых ячеек\n"
+         << "FIND <название товара> - ячейки с товаром\n"
+         << "STOCK <название товара> - остаток товара на складе\n"
+         << "PUTAWAY <название товара> [количество] - куда положить товар\n"
+         << "MOVE <откуда> <куда> <количество> - перенос товара между ячейками\n"
+         << "BEGIN, затем строки ADD/REMOVE, затем COMMIT - применить все вместе\n"
+         << "ROLLBACK - отменить начатую транзакцию\n"
+         << "SNAPSHOT - сохранить снимок склада (при запуске с --data)\n"
+         << "EXIT - выход\n";
+
+    runInteractive(cin, cout);
     return 0;
-}
\ No newline at end of file
+}
@@ -3,24 +3,139 @@
 #include <algorithm>  
 #include <iomanip>    // Для форматирования вывода (setw, setfill)
 #include <sstream>    // Для работы со строками (ostringstream)
+#include <chrono>     // Для замеров времени в бенчмарке
+#include <random>     // Для генерации очереди в бенчмарке
+#include <cstring>    // Для разбора параметров запуска (strcmp)
+#include <set>        // Для локального поиска в планировщике LPT
+#include <climits>    // INT_MIN, LLONG_MIN
+#include <deque>      // Для очередей окон в потоковом режиме
+#include <fstream>    // Для чтения файла отделений
+#include <thread>     // Для пула потоков пакетного режима
+#include <mutex>
+#include <memory>
 
 using namespace std;  
 
 // Структура, описывающая окно приема
 struct Window {
-    int total = 0;      // Общее время обработки в этом окне
-    vector<string> tickets;  // Список талонов в этом окне
+    long long total = 0;      // Общее время обработки в этом окне
+    vector<int> tickets;  // Список талонов в этом окне (номера, печатаются как T001)
     int num;          // Номер окна
 };
 
 // Структура, описывающая посетителя
 struct Visitor {
     int time;           // Продолжительность визита 
-    string ticket;          // Номер талона
+    int ticket;          // Номер талона
 };
 
-// Функция распределения очереди по окнам
+// Загрузка окна для планировщика: только то, что нужно для выбора окна.
+// Хранится отдельно от списков талонов, чтобы выбор окна не трогал их память
+struct WindowLoad {
+    long long total;    // Общее время обработки в окне
+    int index;          // Индекс окна в векторе windows
+
+    // Окно a обслужит раньше окна b (при равной загрузке - окно с меньшим номером)
+    bool before(const WindowLoad& b) const {
+        return total != b.total ? total < b.total : index < b.index;
+    }
+};
+
+// Запись талона в виде T001 в out; номера больше 999 печатаются полностью
+// (T1000, T12345). Возвращает число записанных символов
+size_t format_ticket(char* out, int ticket) {
+    char digits[12];
+    size_t len = 0;
+    unsigned value = static_cast<unsigned>(ticket);
+    do {
+        digits[len++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (len < 3) {
+        digits[len++] = '0';
+    }
+    out[0] = 'T';
+    for (size_t i = 0; i < len; ++i) {
+        out[i + 1] = digits[len - 1 - i];
+    }
+    return len + 1;
+}
+
+// Буфер вывода: строки собираются в нем и уходят в поток крупными блоками,
+// без отдельной операции потока на каждый талон
+struct OutputBuffer {
+    static const size_t SIZE = 1 << 16;
+    char data[SIZE];
+    size_t size = 0;
+    ostream* sink = &cout;
+
+    void flush() {
+        sink->write(data, size);
+        size = 0;
+    }
+    void reserve(size_t n) {
+        if (size + n > SIZE) flush();
+    }
+    void put(const char* text) {
+        size_t n = strlen(text);
+        reserve(n);
+        // Текст длиннее буфера (например, название отделения) - сразу в поток
+        if (n > SIZE) {
+            sink->write(text, n);
+            return;
+        }
+        memcpy(data + size, text, n);
+        size += n;
+    }
+    void put(char c) {
+        reserve(1);
+        data[size++] = c;
+    }
+    void put_number(long long value) {
+        reserve(24);
+        char digits[24];
+        size_t len = 0;
+        bool negative = value < 0;
+        unsigned long long rest = negative ? 0ULL - static_cast<unsigned long long>(value) : value;
+        do {
+            digits[len++] = static_cast<char>('0' + rest % 10);
+            rest /= 10;
+        } while (rest != 0);
+        if (negative) data[size++] = '-';
+        while (len > 0) data[size++] = digits[--len];
+    }
+    void put_ticket(int ticket) {
+        reserve(16);
+        size += format_ticket(data + size, ticket);
+    }
+};
+
+OutputBuffer output;
+
+// Восстановление кучи после увеличения загрузки окна в позиции pos
+void sift_down(vector<WindowLoad>& heap, size_t pos) {
+    WindowLoad item = heap[pos];
+    size_t size = heap.size();
+    while (true) {
+        size_t child = 2 * pos + 1;
+        if (child >= size) break;
+        if (child + 1 < size && heap[child + 1].before(heap[child])) {
+            child++;
+        }
+        if (!heap[child].before(item)) break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = item;
+}
+
+// Функция распределения очереди по окнам.
+// Окна хранятся в двоичной куче по (загрузка, номер): наименее загруженное окно
+// всегда на вершине, и выбор окна для посетителя стоит O(log W)
 vector<Window> distribute(const vector<Visitor>& queue, int num_windows) {
+    if (num_windows <= 0) {
+        return {};  // Без окон распределять некуда
+    }
     vector<Window> windows(num_windows);// Создаем вектор окон с заданным количеством
     
     // Инициализируем номера окон
@@ -28,7 +143,34 @@ vector<Window> distribute(const vector<Visitor>& queue, int num_windows) {
         windows[i].num = i + 1;
     }
 
+    // Пустые окна по возрастанию номера уже образуют кучу
+    vector<WindowLoad> heap(num_windows);
+    for (int i = 0; i < num_windows; ++i) {
+        heap[i] = {0, i};
+    }
+
     // Распределяем посетителей по окнам
+    for (const auto& visitor : queue) {
+        // Окно с минимальным текущим временем обработки - на вершине кучи
+        heap[0].total += visitor.time;
+        windows[heap[0].index].tickets.push_back(visitor.ticket);
+        sift_down(heap, 0);
+    }
+
+    for (const auto& load : heap) {
+        windows[load.index].total = load.total;
+    }
+
+    return windows;
+}
+
+// Прежнее распределение линейным поиском окна, O(N·W) (для сравнения в бенчмарке)
+vector<Window> distribute_linear(const vector<Visitor>& queue, int num_windows) {
+    vector<Window> windows(num_windows);
+    for (int i = 0; i < num_windows; ++i) {
+        windows[i].num = i + 1;
+    }
+
     for (const auto& visitor : queue) {
         // Находим окно с минимальным текущим временем обработки
         auto window = min_element(windows.begin(), windows.end(),
@@ -45,7 +187,890 @@ vector<Window> distribute(const vector<Visitor>& queue, int num_windows) {
     return windows;
 }
 
-int main() {
+// Время работы последнего окна (момент закрытия отделения)
+long long makespan(const vector<Window>& windows) {
+    long long result = 0;
+    for (const auto& window : windows) {
+        result = max(result, window.total);
+    }
+    return result;
+}
+
+// Планирование с меньшим временем закрытия: сначала посетители распределяются
+// по правилу LPT (самые долгие визиты первыми, каждый - в наименее
+// загруженное окно), затем план улучшается локальным поиском - переносом
+// посетителя или обменом двух посетителей между самым загруженным окном и
+// несколькими наименее загруженными. Не более max_steps улучшений
+vector<Window> distribute_lpt(const vector<Visitor>& queue, int num_windows, int max_steps = 100000) {
+    if (num_windows <= 0) {
+        return {};
+    }
+    const int CANDIDATES = 16;  // Сколько наименее загруженных окон пробовать на шаге
+
+    // LPT: порядок посетителей по убыванию времени визита
+    vector<int> order(queue.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return queue[a].time > queue[b].time;
+    });
+
+    // Посетители окна: пары (время визита, номер посетителя) по возрастанию времени
+    vector<multiset<pair<int, int>>> jobs(num_windows);
+    vector<WindowLoad> heap(num_windows);
+    for (int i = 0; i < num_windows; ++i) {
+        heap[i] = {0, i};
+    }
+    for (int v : order) {
+        heap[0].total += queue[v].time;
+        jobs[heap[0].index].insert({queue[v].time, v});
+        sift_down(heap, 0);
+    }
+
+    // Окна по загрузке: первое - наименее, последнее - самое загруженное
+    vector<long long> load(num_windows);
+    set<pair<long long, int>> by_load;
+    for (const auto& entry : heap) {
+        load[entry.index] = entry.total;
+        by_load.insert({entry.total, entry.index});
+    }
+
+    // Перенос посетителя из окна from в окно to
+    auto move_job = [&](int from, int to, pair<int, int> job) {
+        by_load.erase({load[from], from});
+        by_load.erase({load[to], to});
+        jobs[from].erase(jobs[from].find(job));
+        jobs[to].insert(job);
+        load[from] -= job.first;
+        load[to] += job.first;
+        by_load.insert({load[from], from});
+        by_load.insert({load[to], to});
+    };
+
+    for (int step = 0; step < max_steps; ++step) {
+        int top = prev(by_load.end())->second;
+        bool improved = false;
+        int tried = 0;
+        for (auto it = by_load.begin(); it != by_load.end() && tried < CANDIDATES && !improved; ++it, ++tried) {
+            int w = it->second;
+            long long gap = load[top] - load[w];
+            if (w == top || gap <= 1) break;
+
+            // Перенос: визит a < gap уменьшает максимум; лучше всего a ближе к gap / 2
+            auto& src = jobs[top];
+            auto cand = src.lower_bound({static_cast<int>(gap / 2), INT_MIN});
+            for (auto c : {cand, cand == src.begin() ? src.end() : prev(cand)}) {
+                if (c != src.end() && c->first > 0 && c->first < gap) {
+                    move_job(top, w, *c);
+                    improved = true;
+                    break;
+                }
+            }
+            if (improved) break;
+
+            // Обмен: визиты a (из top) и b (из w) с 0 < a - b < gap
+            for (auto a = src.begin(); a != src.end() && !improved; ++a) {
+                auto& dst = jobs[w];
+                auto b = dst.lower_bound({static_cast<int>(a->first - gap / 2), INT_MIN});
+                for (auto c : {b, b == dst.begin() ? dst.end() : prev(b)}) {
+                    if (c == dst.end()) continue;
+                    long long diff = static_cast<long long>(a->first) - c->first;
+                    if (diff > 0 && diff < gap) {
+                        pair<int, int> ja = *a, jb = *c;
+                        move_job(top, w, ja);
+                        move_job(w, top, jb);
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+        if (!improved) break;
+    }
+
+    // Итоговые окна; талоны в окне - в порядке прихода посетителей
+    vector<Window> windows(num_windows);
+    for (int i = 0; i < num_windows; ++i) {
+        windows[i].num = i + 1;
+        windows[i].total = load[i];
+        vector<int> visitors;
+        for (const auto& job : jobs[i]) {
+            visitors.push_back(job.second);
+        }
+        sort(visitors.begin(), visitors.end());
+        for (int v : visitors) {
+            windows[i].tickets.push_back(queue[v].ticket);
+        }
+    }
+    return windows;
+}
+
+// Вывод результатов распределения
+void print_windows(vector<Window> windows, OutputBuffer& out = output) {
+    // Сортировка окон по номеру
+    sort(windows.begin(), windows.end(),
+        [](const Window& a, const Window& b) {
+            return a.num < b.num;
+        });
+
+    for (const auto& window : windows) {
+        out.put(">>> Окно ");
+        out.put_number(window.num);
+        out.put(" (");
+        out.put_number(window.total);
+        out.put(" минут): ");
+        
+        // Вывод списка талонов через запятую
+        bool first = true;
+        for (int ticket : window.tickets) {
+            if (!first) out.put(", ");
+            out.put_ticket(ticket);
+            first = false;
+        }
+        out.put('\n');
+    }
+    out.flush();
+}
+
+// Сравнение распределения кучей и линейным поиском при разном числе окон
+// и посетителей. Линейный вариант запускается, только пока N·W не слишком велико
+void run_benchmark(int max_visitors) {
+    const long long LINEAR_LIMIT = 2000000000LL;   // Предел N·W для линейного варианта
+    mt19937 rng(42);
+    uniform_int_distribution<int> time_dist(1, 30);
+
+    cout << "Посетителей    Окон   Куча, мс  Линейно, мс\n";
+    for (int visitors = 100000; visitors <= max_visitors; visitors *= 10) {
+        vector<Visitor> queue(visitors);
+        for (int i = 0; i < visitors; ++i) {
+            queue[i].time = time_dist(rng);
+            queue[i].ticket = i + 1;
+        }
+        for (int num_windows : {4, 16, 100, 1000, 10000}) {
+            auto start = chrono::steady_clock::now();
+            auto windows = distribute(queue, num_windows);
+            double heap_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            cout << setw(11) << visitors << setw(8) << num_windows << setw(11)
+                 << fixed << setprecision(1) << heap_ms;
+            if (static_cast<long long>(visitors) * num_windows <= LINEAR_LIMIT) {
+                start = chrono::steady_clock::now();
+                auto reference = distribute_linear(queue, num_windows);
+                double linear_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                bool same = true;
+                for (int i = 0; i < num_windows; ++i) {
+                    same = same && windows[i].total == reference[i].total
+                           && windows[i].tickets == reference[i].tickets;
+                }
+                cout << setw(13) << linear_ms << (same ? "" : "  (результаты различаются!)");
+            } else {
+                cout << setw(13) << "-";
+            }
+            cout << '\n';
+        }
+    }
+}
+
+// Поток, который отбрасывает все записанное (для замеров вывода)
+struct NullBuffer : streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char*, streamsize n) override { return n; }
+};
+
+// Путь ENQUEUE -> DISTRIBUTE -> вывод: прежний вариант (талоны-строки из
+// ostringstream, вывод каждого талона через поток) против номеров талонов
+// с форматированием в буфер вывода. Вывод уходит в пустой поток
+void run_print_benchmark(int visitors) {
+    const int NUM_WINDOWS = 100;
+    mt19937 rng(42);
+    uniform_int_distribution<int> time_dist(1, 30);
+    vector<int> times(visitors);
+    for (auto& time : times) {
+        time = time_dist(rng);
+    }
+    NullBuffer null_buffer;
+    ostream null_stream(&null_buffer);
+    auto elapsed = [](chrono::steady_clock::time_point start) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+
+    // Прежний вариант
+    auto start = chrono::steady_clock::now();
+    vector<pair<int, string>> old_queue;
+    for (int i = 0; i < visitors; ++i) {
+        ostringstream num;
+        num << "T" << setw(3) << setfill('0') << i + 1;
+        old_queue.push_back({times[i], num.str()});
+    }
+    double old_enqueue = elapsed(start);
+
+    start = chrono::steady_clock::now();
+    vector<vector<string>> old_tickets(NUM_WINDOWS);
+    vector<long long> old_totals(NUM_WINDOWS);
+    vector<WindowLoad> heap(NUM_WINDOWS);
+    for (int i = 0; i < NUM_WINDOWS; ++i) {
+        heap[i] = {0, i};
+    }
+    for (const auto& visitor : old_queue) {
+        heap[0].total += visitor.first;
+        old_tickets[heap[0].index].push_back(visitor.second);
+        sift_down(heap, 0);
+    }
+    for (const auto& load : heap) {
+        old_totals[load.index] = load.total;
+    }
+    double old_distribute = elapsed(start);
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < NUM_WINDOWS; ++i) {
+        null_stream << ">>> Окно " << i + 1 << " (" << old_totals[i] << " минут): ";
+        bool first = true;
+        for (const auto& ticket : old_tickets[i]) {
+            if (!first) null_stream << ", ";
+            null_stream << ticket;
+            first = false;
+        }
+        null_stream << '\n';
+    }
+    double old_print = elapsed(start);
+
+    // Номера талонов и буфер вывода
+    start = chrono::steady_clock::now();
+    vector<Visitor> queue;
+    for (int i = 0; i < visitors; ++i) {
+        queue.push_back({times[i], i + 1});
+    }
+    double new_enqueue = elapsed(start);
+
+    start = chrono::steady_clock::now();
+    auto windows = distribute(queue, NUM_WINDOWS);
+    double new_distribute = elapsed(start);
+
+    start = chrono::steady_clock::now();
+    output.sink = &null_stream;
+    print_windows(move(windows));
+    output.sink = &cout;
+    double new_print = elapsed(start);
+
+    cout << fixed << setprecision(1);
+    cout << "Посетителей: " << visitors << ", окон: " << NUM_WINDOWS << '\n';
+    cout << "              ENQUEUE, мс  DISTRIBUTE, мс  Вывод, мс  Всего, мс\n";
+    cout << "Строки    " << setw(15) << old_enqueue << setw(16) << old_distribute
+         << setw(11) << old_print << setw(11) << old_enqueue + old_distribute + old_print << '\n';
+    cout << "Номера    " << setw(15) << new_enqueue << setw(16) << new_distribute
+         << setw(11) << new_print << setw(11) << new_enqueue + new_distribute + new_print << '\n';
+}
+
+// Подбор минимального числа окон, при котором отделение закрывается не позже
+// заданного времени. Проверка числа окон - тот же жадный распределитель, что
+// и в distribute(), но только по загрузкам окон, без списков талонов.
+// Пока визиты короткие, вместо кучи хватает счетчиков окон по загрузке:
+// загрузки всех окон лежат в [минимум, минимум + самый долгий визит], а время
+// закрытия зависит только от набора загрузок, а не от номеров окон.
+// Время закрытия для каждого проверенного числа окон запоминается: с ростом
+// числа окон оно не увеличивается, поэтому запомненные проверки сразу сужают
+// двоичный поиск для любого следующего лимита
+struct WindowPlanner {
+    static const int MAX_BUCKETS = 1 << 20;  // Предел самого долгого визита для счетчиков
+    vector<int> times;              // Продолжительности визитов в порядке прихода
+    long long sum = 0;              // Суммарное время всех визитов
+    int longest = 0;                // Самый долгий визит
+    vector<pair<int, long long>> known;  // (окон, время закрытия) по возрастанию числа окон
+    vector<WindowLoad> heap;        // Куча, переиспользуемая между проверками
+    vector<int> windows_at;         // Окон с загрузкой L - в ячейке L % (longest + 1)
+
+    // Время визита неотрицательно (проверяется при ENQUEUE)
+    void add(int time) {
+        times.push_back(time);
+        sum += time;
+        longest = max(longest, time);
+        known.clear();
+    }
+
+    // Время закрытия отделения с num_windows окнами
+    long long finish_time(int num_windows) {
+        auto it = lower_bound(known.begin(), known.end(), make_pair(num_windows, LLONG_MIN));
+        if (it != known.end() && it->first == num_windows) {
+            return it->second;
+        }
+
+        long long finish = 0;
+        if (longest < MAX_BUCKETS) {
+            // Очередной посетитель уходит в любое окно с минимальной загрузкой
+            size_t buckets = static_cast<size_t>(longest) + 1;
+            windows_at.assign(buckets, 0);
+            windows_at[0] = num_windows;
+            long long lowest = 0;
+            for (int time : times) {
+                windows_at[lowest % buckets]--;
+                windows_at[(lowest + time) % buckets]++;
+                finish = max(finish, lowest + time);
+                while (windows_at[lowest % buckets] == 0) {
+                    lowest++;
+                }
+            }
+            known.insert(it, {num_windows, finish});
+            return finish;
+        }
+
+        // Первые num_windows посетителей попадают каждый в свое пустое окно
+        size_t first = min(times.size(), static_cast<size_t>(num_windows));
+        heap.resize(num_windows);
+        for (int i = 0; i < num_windows; ++i) {
+            heap[i] = {i < static_cast<int>(first) ? times[i] : 0, i};
+            finish = max(finish, heap[i].total);
+        }
+        make_heap(heap.begin(), heap.end(), [](const WindowLoad& a, const WindowLoad& b) {
+            return b.before(a);
+        });
+        for (size_t i = first; i < times.size(); ++i) {
+            heap[0].total += times[i];
+            finish = max(finish, heap[0].total);
+            sift_down(heap, 0);
+        }
+        known.insert(it, {num_windows, finish});
+        return finish;
+    }
+
+    // Минимальное число окон для закрытия не позже limit; -1, если это
+    // невозможно (какой-то визит длиннее лимита)
+    int min_windows(long long limit) {
+        if (times.empty()) {
+            return 1;
+        }
+        if (longest > limit) {
+            return -1;
+        }
+        // Все визиты нулевой длины: хватит одного окна при любом лимите >= 0.
+        // Иначе longest > 0, значит limit > 0 и делить на него можно
+        if (sum == 0) {
+            return 1;
+        }
+        // Меньше чем sum / limit окон не хватит никакому распределению, а при
+        // жадном распределении последний посетитель начинает прием не позже
+        // (sum - t) / W, поэтому W >= sum / (limit - longest + 1) точно хватит
+        long long low = max(1LL, (sum + limit - 1) / limit);
+        long long high = static_cast<long long>(times.size());
+        if (limit > longest) {
+            high = min(high, (sum + limit - longest) / (limit - longest + 1) + 1);
+        }
+        // Сужение по запомненным проверкам: первое запомненное число окон,
+        // которого хватает, и последнее перед ним, которого не хватает
+        auto enough = partition_point(known.begin(), known.end(),
+            [limit](const pair<int, long long>& probe) { return probe.second > limit; });
+        if (enough != known.end()) {
+            high = min<long long>(high, enough->first);
+        }
+        if (enough != known.begin()) {
+            low = max<long long>(low, prev(enough)->first + 1);
+        }
+        low = min(low, high);
+        while (low < high) {
+            long long middle = low + (high - low) / 2;
+            if (finish_time(static_cast<int>(middle)) <= limit) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        return static_cast<int>(low);
+    }
+};
+
+// Скорость подбора числа окон: серия запросов с разными лимитами по одной
+// очереди против двоичного поиска с полным distribute() на каждой проверке
+void run_windows_benchmark(int visitors) {
+    const int QUERIES = 1000;
+    mt19937 rng(42);
+    uniform_int_distribution<int> time_dist(1, 30);
+    vector<Visitor> queue(visitors);
+    WindowPlanner planner;
+    for (int i = 0; i < visitors; ++i) {
+        queue[i] = {time_dist(rng), i + 1};
+        planner.add(queue[i].time);
+    }
+
+    // Лимиты от 8 часов до недели работы отделения
+    uniform_int_distribution<long long> limit_dist(480, 10080);
+    vector<long long> limits(QUERIES);
+    for (auto& limit : limits) {
+        limit = limit_dist(rng);
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<int> answers;
+    for (long long limit : limits) {
+        answers.push_back(planner.min_windows(limit));
+    }
+    double planner_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Повторная серия с теми же лимитами отвечает по запомненным проверкам
+    start = chrono::steady_clock::now();
+    bool repeat_same = true;
+    for (int q = 0; q < QUERIES; ++q) {
+        repeat_same = repeat_same && planner.min_windows(limits[q]) == answers[q];
+    }
+    double repeat_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Прямой двоичный поиск по [1, N] с полным distribute() (первые запросы)
+    const int CHECKED = 10;
+    start = chrono::steady_clock::now();
+    bool same = true;
+    for (int q = 0; q < CHECKED; ++q) {
+        int low = 1, high = visitors;
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (makespan(distribute(queue, middle)) <= limits[q]) {
+                high = middle;
+            } else {
+                low = middle + 1;
+            }
+        }
+        same = same && low == answers[q];
+    }
+    double naive_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // Граничные случаи: визиты нулевой длины (ENQUEUE 0) укладываются даже
+    // в лимит 0, а непустая очередь в него не укладывается
+    WindowPlanner zero;
+    zero.add(0);
+    zero.add(0);
+    bool edges = zero.min_windows(0) == 1 && zero.min_windows(1) == 1 && planner.min_windows(0) == -1;
+
+    cout << fixed << setprecision(3);
+    cout << "Посетителей: " << visitors << ", запросов: " << QUERIES << '\n';
+    cout << "Подбор, первая серия:  " << planner_ms / QUERIES << " мс на запрос\n";
+    cout << "Подбор, повторная:     " << repeat_ms / QUERIES << " мс на запрос"
+         << (repeat_same ? "" : "  (результаты различаются!)") << '\n';
+    cout << "Полный distribute():   " << naive_ms / CHECKED << " мс на запрос"
+         << (same ? "" : "  (результаты различаются!)") << '\n';
+    cout << "Граничные случаи:      " << (edges ? "верно" : "ошибка!") << '\n';
+}
+
+// Потоковая выдача талонов: посетитель получает окно сразу при ENQUEUE.
+// Окна хранятся в индексной куче по (оставшаяся загрузка, номер) - куча
+// помнит позицию каждого окна, поэтому и назначение посетителя, и отметка
+// об окончании приема стоят O(log W)
+struct Dispatcher {
+    struct Pending {
+        int time;       // Продолжительность визита
+        int ticket;     // Номер талона
+    };
+
+    vector<WindowLoad> heap;        // Куча окон, наименее загруженное - на вершине
+    vector<int> position;           // Позиция окна в куче
+    vector<deque<Pending>> waiting; // Ожидающие посетители окна в порядке прихода
+
+    explicit Dispatcher(int num_windows)
+        : heap(num_windows), position(num_windows), waiting(num_windows) {
+        for (int i = 0; i < num_windows; ++i) {
+            heap[i] = {0, i};
+            position[i] = i;
+        }
+    }
+
+    void place(size_t pos, const WindowLoad& item) {
+        heap[pos] = item;
+        position[item.index] = static_cast<int>(pos);
+    }
+
+    void sift_up(size_t pos) {
+        WindowLoad item = heap[pos];
+        while (pos > 0) {
+            size_t parent = (pos - 1) / 2;
+            if (!item.before(heap[parent])) break;
+            place(pos, heap[parent]);
+            pos = parent;
+        }
+        place(pos, item);
+    }
+
+    void sift_down(size_t pos) {
+        WindowLoad item = heap[pos];
+        size_t size = heap.size();
+        while (true) {
+            size_t child = 2 * pos + 1;
+            if (child >= size) break;
+            if (child + 1 < size && heap[child + 1].before(heap[child])) {
+                child++;
+            }
+            if (!heap[child].before(item)) break;
+            place(pos, heap[child]);
+            pos = child;
+        }
+        place(pos, item);
+    }
+
+    // Назначение посетителя в наименее загруженное окно; возвращает индекс окна
+    int assign(int time, int ticket) {
+        int window = heap[0].index;
+        heap[0].total += time;
+        waiting[window].push_back({time, ticket});
+        sift_down(0);
+        return window;
+    }
+
+    // Окно закончило прием очередного посетителя; false, если очередь окна пуста
+    bool complete(int window, Pending& done) {
+        if (waiting[window].empty()) {
+            return false;
+        }
+        done = waiting[window].front();
+        waiting[window].pop_front();
+        size_t pos = position[window];
+        heap[pos].total -= done.time;
+        sift_up(pos);
+        return true;
+    }
+
+    long long remaining(int window) const {
+        return heap[position[window]].total;
+    }
+};
+
+// Текущее состояние окон: оставшееся время и ожидающие талоны
+void print_dispatcher(const Dispatcher& dispatcher) {
+    for (size_t i = 0; i < dispatcher.waiting.size(); ++i) {
+        output.put(">>> Окно ");
+        output.put_number(i + 1);
+        output.put(" (");
+        output.put_number(dispatcher.remaining(i));
+        output.put(" минут): ");
+        bool first = true;
+        for (const auto& visitor : dispatcher.waiting[i]) {
+            if (!first) output.put(", ");
+            output.put_ticket(visitor.ticket);
+            first = false;
+        }
+        output.put('\n');
+    }
+    output.flush();
+}
+
+// Вывод одного талона в cout
+void print_ticket(int ticket) {
+    char buffer[16];
+    cout.write(buffer, format_ticket(buffer, ticket));
+}
+
+// Потоковый режим: ENQUEUE сразу назначает окно, DONE <окно> отмечает
+// окончание приема первого посетителя окна, DISTRIBUTE печатает текущее
+// состояние и может вызываться сколько угодно раз, EXIT завершает работу
+void run_stream() {
+    int num_windows;
+    cout << ">>> Введите кол-во окон\n<<< ";
+    if (!(cin >> num_windows) || num_windows <= 0) {
+        cout << ">>> Неверное количество окон\n";
+        return;
+    }
+
+    Dispatcher dispatcher(num_windows);
+    int ticket_num = 1;
+    string command;
+    while (cout << "<<< ", cin >> command) {
+        if (command == "ENQUEUE") {
+            int enqueue;
+            if (!(cin >> enqueue) || enqueue < 0) {
+                cout << ">>> Неверное время визита\n";
+                continue;
+            }
+            int ticket = ticket_num++;
+            int window = dispatcher.assign(enqueue, ticket);
+            cout << ">>> ";
+            print_ticket(ticket);
+            cout << " -> окно " << window + 1 << '\n';
+        }
+        else if (command == "DONE") {
+            int window;
+            cin >> window;
+            Dispatcher::Pending done;
+            if (window < 1 || window > num_windows) {
+                cout << ">>> Нет окна " << window << '\n';
+            } else if (!dispatcher.complete(window - 1, done)) {
+                cout << ">>> Окно " << window << " свободно\n";
+            } else {
+                cout << ">>> ";
+                print_ticket(done.ticket);
+                cout << " принят в окне " << window
+                     << ", осталось " << dispatcher.remaining(window - 1) << " минут\n";
+            }
+        }
+        else if (command == "DISTRIBUTE") {
+            print_dispatcher(dispatcher);
+        }
+        else if (command == "EXIT") {
+            break;
+        }
+        else {
+            cout << ">>> Неизвестная команда\n";
+        }
+    }
+}
+
+// Задержка назначения одного посетителя в потоковом режиме при постоянном
+// потоке: на каждого нового посетителя в среднем одно окно заканчивает прием,
+// поэтому очереди не растут. Печатаются перцентили задержки ENQUEUE
+void run_stream_benchmark(int visitors) {
+    mt19937 rng(42);
+    uniform_int_distribution<int> time_dist(1, 30);
+
+    cout << "    Окон   Посетителей  Среднее, нс  p50, нс  p99, нс  Макс, нс\n";
+    for (int num_windows : {4, 16, 100, 1000, 10000}) {
+        Dispatcher dispatcher(num_windows);
+        uniform_int_distribution<int> window_dist(0, num_windows - 1);
+        vector<int> latency(visitors);
+        Dispatcher::Pending done;
+        long long total_ns = 0;
+
+        for (int i = 0; i < visitors; ++i) {
+            int ticket = i + 1;
+            int time = time_dist(rng);
+
+            auto start = chrono::steady_clock::now();
+            dispatcher.assign(time, ticket);
+            auto ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+            latency[i] = static_cast<int>(ns);
+            total_ns += ns;
+
+            dispatcher.complete(window_dist(rng), done);
+        }
+
+        sort(latency.begin(), latency.end());
+        cout << setw(8) << num_windows << setw(14) << visitors
+             << setw(13) << total_ns / max(visitors, 1)
+             << setw(9) << latency[visitors / 2]
+             << setw(9) << latency[static_cast<size_t>(visitors * 0.99)]
+             << setw(10) << latency.back() << '\n';
+    }
+}
+
+// Отделение для пакетного планирования
+struct Branch {
+    string name;            // Название отделения
+    int num_windows;        // Количество окон
+    vector<Visitor> queue;  // Очередь посетителей
+};
+
+// Чтение файла отделений. Формат:
+//   BRANCH <название> <кол-во окон>
+//   ENQUEUE <время>
+//   ...
+// Талоны нумеруются в каждом отделении с T001. false при ошибке формата
+bool load_branches(const char* path, vector<Branch>& branches) {
+    ifstream in(path);
+    if (!in) {
+        cout << ">>> Не удалось открыть файл " << path << '\n';
+        return false;
+    }
+    string command;
+    while (in >> command) {
+        if (command == "BRANCH") {
+            Branch branch;
+            if (!(in >> branch.name >> branch.num_windows) || branch.num_windows <= 0) {
+                cout << ">>> Неверное описание отделения " << branch.name << '\n';
+                return false;
+            }
+            branches.push_back(move(branch));
+        } else if (command == "ENQUEUE" && !branches.empty()) {
+            int time;
+            if (!(in >> time) || time < 0) {
+                cout << ">>> Неверное время визита в отделении " << branches.back().name << '\n';
+                return false;
+            }
+            auto& queue = branches.back().queue;
+            queue.push_back({time, static_cast<int>(queue.size()) + 1});
+        } else {
+            cout << ">>> Неизвестная команда в файле: " << command << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
+// Пул потоков с перехватом работы: у каждого потока своя очередь номеров
+// отделений. Поток берет работу с конца своей очереди, а когда она пуста -
+// забирает с начала очереди другого потока
+class StealingPool {
+public:
+    explicit StealingPool(int num_threads) : queues(num_threads) {}
+
+    // Выполнение job(i) для всех i из tasks; задачи заранее раскладываются
+    // по очередям потоков по кругу
+    template <typename Job>
+    void run(const vector<int>& tasks, Job job) {
+        int num_threads = static_cast<int>(queues.size());
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            queues[i % num_threads].tasks.push_back(tasks[i]);
+        }
+        vector<thread> threads;
+        for (int t = 0; t < num_threads; ++t) {
+            threads.emplace_back([this, t, &job] {
+                int task;
+                while (take(t, task)) {
+                    job(task, t);
+                }
+            });
+        }
+        for (auto& worker : threads) {
+            worker.join();
+        }
+    }
+
+private:
+    struct TaskQueue {
+        mutex lock;
+        deque<int> tasks;
+    };
+    vector<TaskQueue> queues;
+
+    bool take(int self, int& task) {
+        {
+            lock_guard<mutex> guard(queues[self].lock);
+            if (!queues[self].tasks.empty()) {
+                task = queues[self].tasks.back();
+                queues[self].tasks.pop_back();
+                return true;
+            }
+        }
+        // Своя очередь пуста: перехват у остальных потоков. Новых задач
+        // не появляется, поэтому один пустой обход означает конец работы
+        int num_threads = static_cast<int>(queues.size());
+        for (int k = 1; k < num_threads; ++k) {
+            auto& victim = queues[(self + k) % num_threads];
+            lock_guard<mutex> guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Распределение всех отделений на num_threads потоках. Результат каждого
+// отделения собирается в свою строку, поэтому итоговый вывод не зависит
+// от числа потоков и порядка выполнения
+vector<string> distribute_branches(const vector<Branch>& branches, int num_threads) {
+    vector<string> results(branches.size());
+
+    // Сначала самые большие отделения - так потоки заканчивают почти одновременно
+    vector<int> order(branches.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return branches[a].queue.size() > branches[b].queue.size();
+    });
+
+    vector<unique_ptr<OutputBuffer>> buffers;
+    for (int t = 0; t < num_threads; ++t) {
+        buffers.push_back(make_unique<OutputBuffer>());
+    }
+    StealingPool pool(num_threads);
+    pool.run(order, [&](int index, int worker) {
+        const Branch& branch = branches[index];
+        ostringstream result;
+        OutputBuffer& out = *buffers[worker];
+        out.sink = &result;
+        out.put("=== ");
+        out.put(branch.name.c_str());
+        out.put('\n');
+        print_windows(distribute(branch.queue, branch.num_windows), out);
+        results[index] = result.str();
+    });
+    return results;
+}
+
+// Пакетный режим: lab5_2 --branches <файл> [потоков]
+void run_branches(const char* path, int num_threads) {
+    vector<Branch> branches;
+    if (!load_branches(path, branches)) {
+        return;
+    }
+    for (const auto& result : distribute_branches(branches, num_threads)) {
+        cout.write(result.data(), result.size());
+    }
+}
+
+// Масштабирование пакетного режима по числу потоков на случайных отделениях.
+// Результат каждого прогона сравнивается с однопоточным
+void run_branches_benchmark(int num_branches) {
+    mt19937 rng(42);
+    uniform_int_distribution<int> time_dist(1, 30);
+    uniform_int_distribution<int> size_dist(1000, 100000);
+    uniform_int_distribution<int> windows_dist(1, 50);
+    vector<Branch> branches(num_branches);
+    for (int i = 0; i < num_branches; ++i) {
+        branches[i].name = "B" + to_string(i + 1);
+        branches[i].num_windows = windows_dist(rng);
+        int visitors = size_dist(rng);
+        for (int v = 0; v < visitors; ++v) {
+            branches[i].queue.push_back({time_dist(rng), v + 1});
+        }
+    }
+
+    int max_threads = max(1u, thread::hardware_concurrency());
+    cout << "Отделений: " << num_branches << ", ядер: " << max_threads << '\n';
+    cout << "Потоков   Время, мс  Ускорение\n";
+    vector<string> reference;
+    double base_ms = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        auto start = chrono::steady_clock::now();
+        auto results = distribute_branches(branches, threads);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (threads == 1) {
+            reference = results;
+            base_ms = ms;
+        }
+        cout << setw(7) << threads << setw(12) << fixed << setprecision(1) << ms
+             << setw(11) << setprecision(2) << base_ms / ms
+             << (results == reference ? "" : "  (результаты различаются!)") << '\n';
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;  // Последним прогоном - все ядра
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Режим бенчмарка: lab5_2 --bench [максимум посетителей]
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmark(argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    // Бенчмарк вывода: lab5_2 --bench-print [посетителей]
+    if (argc > 1 && strcmp(argv[1], "--bench-print") == 0) {
+        run_print_benchmark(argc > 2 ? max(atoi(argv[2]), 1) : 3000000);
+        return 0;
+    }
+    if (argc > 2 && strcmp(argv[1], "--branches") == 0) {
+        int threads = argc > 3 ? atoi(argv[3]) : static_cast<int>(thread::hardware_concurrency());
+        run_branches(argv[2], max(threads, 1));
+        return 0;
+    }
+    // Бенчмарк пакетного режима: lab5_2 --bench-branches [отделений]
+    if (argc > 1 && strcmp(argv[1], "--bench-branches") == 0) {
+        run_branches_benchmark(argc > 2 ? max(atoi(argv[2]), 1) : 400);
+        return 0;
+    }
+    // Бенчмарк подбора числа окон: lab5_2 --bench-windows [посетителей]
+    if (argc > 1 && strcmp(argv[1], "--bench-windows") == 0) {
+        run_windows_benchmark(argc > 2 ? max(atoi(argv[2]), 1) : 100000);
+        return 0;
+    }
+    // Потоковый режим: lab5_2 --stream
+    if (argc > 1 && strcmp(argv[1], "--stream") == 0) {
+        run_stream();
+        return 0;
+    }
+    // Бенчмарк потокового режима: lab5_2 --bench-stream [посетителей]
+    if (argc > 1 && strcmp(argv[1], "--bench-stream") == 0) {
+        run_stream_benchmark(argc > 2 ? max(atoi(argv[2]), 1) : 1000000);
+        return 0;
+    }
+
+
     // Запрос количества окон
     int num_windows;
     cout << ">>> Введите кол-во окон\n<<< ";
@@ -53,6 +1078,8 @@ int main() {
 
     // Очередь посетителей
     vector<Visitor> queue;
+    // Подбор числа окон по той же очереди
+    WindowPlanner planner;
     // Счетчик для генерации номеров талонов
     int ticket_num = 1;
 
@@ -60,48 +1087,67 @@ int main() {
     while (true) {
         string command;
         cout << "<<< ";
-        cin >> command;
+        if (!(cin >> command)) break;  // Конец ввода
 
         // Обработка команды ENQUEUE
         if (command == "ENQUEUE") {
             int enqueue;
-            cin >> enqueue;
-            
-            // Генерация номера талона
-            ostringstream num;
-            num << "T" << setw(3) << setfill('0') << ticket_num++;
-            string ticket = num.str();
-            
-            // Добавление посетителя в очередь
+            if (!(cin >> enqueue) || enqueue < 0) {
+                cout << ">>> Неверное время визита\n";
+                continue;
+            }
+
+            // Добавление посетителя в очередь под очередным номером талона
+            int ticket = ticket_num++;
             queue.push_back({enqueue, ticket});
-            cout << ">>> " << ticket << '\n';
+            planner.add(enqueue);
+            cout << ">>> ";
+            print_ticket(ticket);
+            cout << '\n';
         }
         // Обработка команды DISTRIBUTE
         else if (command == "DISTRIBUTE") {
-            // Распределение очереди по окнам
-            auto windows = distribute(queue, num_windows);
-            
-            // Сортировка окон по номеру
-            sort(windows.begin(), windows.end(),
-                [](const Window& a, const Window& b) {
-                    return a.num < b.num;
-                });
-
-            // Вывод результатов распределения
-            for (const auto& window : windows) {
-                cout << ">>> Окно " << window.num << " (" << window.total << " минут): ";
-                
-                // Вывод списка талонов через запятую
-                bool first = true;
-                for (const auto& ticket : window.tickets) {
-                    if (!first) cout << ", ";
-                    cout << ticket;
-                    first = false;
-                }
-                cout << '\n';
+            // Распределение очереди по окнам и вывод результатов
+            print_windows(distribute(queue, num_windows));
+            break;  // Завершение работы после распределения
+        }
+        // Обработка команды PLAN - распределение LPT с локальным поиском
+        // и сравнение с жадным распределением
+        else if (command == "PLAN") {
+            auto start = chrono::steady_clock::now();
+            long long greedy = makespan(distribute(queue, num_windows));
+            double greedy_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            start = chrono::steady_clock::now();
+            auto windows = distribute_lpt(queue, num_windows);
+            double lpt_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            long long planned = makespan(windows);
+
+            print_windows(move(windows));
+            cout << fixed << setprecision(2);
+            cout << ">>> Жадное распределение: " << greedy << " минут (" << greedy_ms << " мс)\n";
+            cout << ">>> LPT + локальный поиск: " << planned << " минут (" << lpt_ms << " мс)";
+            if (greedy > 0) {
+                cout << ", лучше на " << (greedy - planned) * 100.0 / greedy << "%";
             }
+            cout << '\n';
             break;  // Завершение работы после распределения
         }
+        // Обработка команды MIN_WINDOWS - наименьшее число окон, при котором
+        // отделение закроется не позже заданного времени
+        else if (command == "MIN_WINDOWS") {
+            long long limit;
+            if (!(cin >> limit) || limit < 0) {
+                cout << ">>> Неверное время закрытия\n";
+                continue;
+            }
+            int windows = planner.min_windows(limit);
+            if (windows < 0) {
+                cout << ">>> Невозможно: визит длится " << planner.longest << " минут\n";
+            } else {
+                cout << ">>> Окон: " << windows << '\n';
+            }
+        }
         // Обработка неизвестных команд
         else {
             cout << ">>> Неизвестная команда\n";
@@ -0,0 +1,177 @@
+#include "concurrent_storage.h"
+#include <iostream>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+// Первая версия - снимок текущего хранилища
+ConcurrentStorage::ConcurrentStorage() {
+    current.store(makeSnapshot().release());
+}
+
+ConcurrentStorage::~ConcurrentStorage() {
+    delete current.load();
+}
+
+// Первая свободная ячейка для нового читателя
+int ConcurrentStorage::registerReader() {
+    for (int i = 0; i < MAX_READERS; ++i) {
+        bool expected = false;
+        if (!readers[i].used.load() && readers[i].used.compare_exchange_strong(expected, true)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Освобождение ячейки: читатель уже вышел из read, поэтому эпоха равна 0
+void ConcurrentStorage::unregisterReader(int reader) {
+    if (reader < 0 || reader >= MAX_READERS) {
+        return;
+    }
+    readers[reader].epoch.store(0);
+    readers[reader].used.store(false);
+}
+
+// Изменение маршрута и публикация новой версии
+void ConcurrentStorage::update(const string& trolleyName, const vector<string>& stops) {
+    lock_guard<mutex> lock(writer);
+    addTrolleyRoute(trolleyName, stops);
+    publish(makeSnapshot());
+}
+
+// Загрузка файла и публикация новой версии
+bool ConcurrentStorage::load(const string& path, LoadResult& result) {
+    lock_guard<mutex> lock(writer);
+    bool loaded = loadRoutes(path, result);
+    publish(makeSnapshot());
+    return loaded;
+}
+
+// Подмена текущего снимка. Читатель, взявший старый снимок, отметил эпоху
+// до подмены, поэтому его эпоха меньше новой; читатели с новой эпохой или
+// без отметки старый снимок уже не получат
+void ConcurrentStorage::publish(unique_ptr<NetworkSnapshot> next) {
+    const NetworkSnapshot* old = current.exchange(next.release());
+    uint64_t newEpoch = epoch.fetch_add(1) + 1;
+    for (int i = 0; i < MAX_READERS; ++i) {
+        while (true) {
+            uint64_t readerEpoch = readers[i].epoch.load();
+            if (readerEpoch == 0 || readerEpoch >= newEpoch) {
+                break;
+            }
+            this_thread::yield();
+        }
+    }
+    delete old;
+    published++;
+}
+
+// Замер чтения снимков при непрерывной записи
+void runConcurrentBenchmark(int maxReaders, int trolleys, int stops) {
+    maxReaders = min(max(maxReaders, 1), ConcurrentStorage::MAX_READERS);
+    trolleys = max(trolleys, 1);
+    stops = max(stops, 1);
+    mt19937 rng(42);
+    uniform_int_distribution<int> lengthDist(15, 40);
+
+    // Названия заранее, чтобы при чтении не создавать строк
+    vector<string> trolleyNames(trolleys);
+    vector<string> stopNames(stops);
+    for (int t = 0; t < trolleys; ++t) {
+        trolleyNames[t] = "T" + to_string(t + 1);
+    }
+    for (int s = 0; s < stops; ++s) {
+        stopNames[s] = "S" + to_string(s + 1);
+    }
+    auto randomRoute = [&](mt19937& generator) {
+        vector<string> route(lengthDist(generator));
+        for (auto& stop : route) {
+            stop = stopNames[generator() % stops];
+        }
+        return route;
+    };
+
+    initializeStorage();
+    for (int t = 0; t < trolleys; ++t) {
+        addTrolleyRoute(trolleyNames[t], randomRoute(rng));
+    }
+    ConcurrentStorage storage;
+
+    cout << "Trolleys: " << trolleys << ", stops: " << stops << endl;
+    // Число читателей: 1, 2, 4 ... и maxReaders
+    vector<int> rounds;
+    for (int readers = 1; readers < maxReaders; readers *= 2) {
+        rounds.push_back(readers);
+    }
+    rounds.push_back(maxReaders);
+
+    const auto roundTime = chrono::milliseconds(1000);
+    for (int readers : rounds) {
+        atomic<bool> stop(false);
+        atomic<long long> reads(0);
+        atomic<long long> inconsistent(0);
+        uint64_t versionsBefore = storage.versions();
+
+        // Писатель: CREATE_TRL со случайным маршрутом для случайного троллейбуса
+        thread writerThread([&]() {
+            mt19937 generator(7);
+            while (!stop.load()) {
+                storage.update(trolleyNames[generator() % trolleys], randomRoute(generator));
+            }
+        });
+
+        // Читатели: поровну TRL_IN_STOP и STOPS_IN_TRL; каждое 64-е чтение
+        // проверяет, что снимок согласован (троллейбус есть на всех своих остановках).
+        // Ячейки занимаются на время раунда и освобождаются для следующего
+        vector<thread> readerThreads;
+        for (int r = 0; r < readers; ++r) {
+            readerThreads.emplace_back([&, r]() {
+                int slot = storage.registerReader();
+                if (slot < 0) {
+                    return;
+                }
+                mt19937 generator(100 + r);
+                long long count = 0, bad = 0;
+                while (!stop.load(memory_order_relaxed)) {
+                    storage.read(slot, [&](const NetworkSnapshot& snapshot) {
+                        if (count % 2 == 0) {
+                            snapshot.trolleysAtStop(stopNames[generator() % stops]);
+                        } else {
+                            const string& trolley = trolleyNames[generator() % trolleys];
+                            snapshot.forEachTransfer(trolley, [](const string&, const NameList&) {});
+                            if (count % 64 == 1) {
+                                for (const auto& stopName : snapshot.stopsOfTrolley(trolley)) {
+                                    bool found = false;
+                                    for (const auto& other : snapshot.trolleysAtStop(stopName)) {
+                                        found = found || other == trolley;
+                                    }
+                                    bad += found ? 0 : 1;
+                                }
+                            }
+                        }
+                    });
+                    count++;
+                }
+                storage.unregisterReader(slot);
+                reads += count;
+                inconsistent += bad;
+            });
+        }
+
+        this_thread::sleep_for(roundTime);
+        stop.store(true);
+        for (auto& reader : readerThreads) {
+            reader.join();
+        }
+        writerThread.join();
+
+        double seconds = chrono::duration<double>(roundTime).count();
+        cout << "Readers: " << readers << ", reads/s: " << static_cast<long long>(reads.load() / seconds)
+             << ", versions published: " << storage.versions() - versionsBefore
+             << (inconsistent.load() == 0 ? "" : " (inconsistent snapshots!)") << endl;
+    }
+}
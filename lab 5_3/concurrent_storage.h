@@ -0,0 +1,80 @@
+#ifndef CONCURRENT_STORAGE_H
+#define CONCURRENT_STORAGE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include "storage.h"
+
+using namespace std;
+
+// Хранилище для одновременного чтения и изменения маршрутов.
+// Читатели работают с неизменяемым снимком сети и не берут блокировок:
+// отмечают в своей ячейке эпоху начала чтения и берут текущий снимок.
+// Писатель меняет основное хранилище, строит по нему следующий снимок и
+// подменяет текущий одной атомарной операцией (как в RCU); старый снимок
+// удаляется, когда все читатели, которые могли его взять, закончили чтение
+class ConcurrentStorage {
+public:
+    static constexpr int MAX_READERS = 64;
+
+    // Снимок текущего состояния хранилища становится первой версией
+    ConcurrentStorage();
+    ~ConcurrentStorage();
+
+    // Номер свободной ячейки для нового потока-читателя (0..MAX_READERS-1)
+    // или -1, если заняты все MAX_READERS ячеек
+    int registerReader();
+
+    // Освобождение ячейки читателя, закончившего работу; ячейку может
+    // занять следующий читатель
+    void unregisterReader(int reader);
+
+    // Чтение снимка потоком с ячейкой reader: visit(const NetworkSnapshot&).
+    // Снимок действителен только внутри visit
+    template <typename Visit>
+    auto read(int reader, Visit visit) {
+        readers[reader].epoch.store(epoch.load());
+        const NetworkSnapshot* snapshot = current.load();
+        struct Leave {
+            atomic<uint64_t>& slot;
+            ~Leave() { slot.store(0); }
+        } leave{readers[reader].epoch};
+        return visit(*snapshot);
+    }
+
+    // Изменение маршрута троллейбуса (как CREATE_TRL) и публикация новой
+    // версии; писатели выполняются по одному
+    void update(const string& trolleyName, const vector<string>& stops);
+
+    // Загрузка маршрутов из файла (как LOAD) и публикация новой версии
+    bool load(const string& path, LoadResult& result);
+
+    // Количество опубликованных версий
+    uint64_t versions() const { return published.load(); }
+
+private:
+    // Ячейка читателя на своей линии кэша: эпоха, в которую читатель взял
+    // снимок, или 0, если он сейчас не читает; used - ячейка занята потоком
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{0};
+        atomic<bool> used{false};
+    };
+
+    void publish(unique_ptr<NetworkSnapshot> next);
+
+    atomic<const NetworkSnapshot*> current{nullptr};
+    atomic<uint64_t> epoch{1};
+    atomic<uint64_t> published{0};
+    ReaderSlot readers[MAX_READERS];
+    mutex writer;
+};
+
+// Замер чтения (TRL_IN_STOP и STOPS_IN_TRL по снимку) из 1, 2, 4 ...
+// maxReaders потоков, пока писатель непрерывно меняет маршруты
+// trolleys - количество троллейбусов, stops - количество остановок
+void runConcurrentBenchmark(int maxReaders, int trolleys, int stops);
+
+#endif // CONCURRENT_STORAGE_H
@@ -3,12 +3,14 @@
 
 #include <string>
 #include <vector>
+#include "concurrent_storage.h"
 
 using namespace std;
 
-// Создание нового троллейбуса с указанным маршрутом
+// Создание нового троллейбуса с указанным маршрутом и публикация новой версии
+// storage - хранилище
 // trolleyName - название троллейбуса
 // stops - список остановок на маршруте
-void executeCreateTrolley(const string& trolleyName, const vector<string>& stops);
+void executeCreateTrolley(ConcurrentStorage& storage, const string& trolleyName, const vector<string>& stops);
 
 #endif // CREATE_TRL_H
@@ -0,0 +1,82 @@
+#include "load_routes.h"
+#include "storage.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+using namespace std;
+
+// Обработка команды загрузки маршрутов из файла
+void executeLoadRoutes(ConcurrentStorage& storage, const string& path) {
+    LoadResult result;
+    auto start = chrono::steady_clock::now();
+    if (!storage.load(path, result)) {
+        cout << "Error: " << result.error << endl;
+        return;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Loaded " << result.routes << " routes from " << path << ": " << result.trolleys
+         << " trolleys, " << result.stops << " stops (" << ms << " ms)." << endl;
+}
+
+// Сравнение загрузки файла с построчным добавлением маршрутов
+void runLoadBenchmark(int trolleys, int stops) {
+    const string path = "routes_bench.txt";
+    mt19937 rng(42);
+    uniform_int_distribution<int> stopDist(1, max(stops, 1));
+    uniform_int_distribution<int> lengthDist(15, 40);
+    {
+        ofstream out(path);
+        for (int t = 1; t <= trolleys; ++t) {
+            out << "T" << t;
+            int length = lengthDist(rng);
+            for (int i = 0; i < length; ++i) {
+                out << " S" << stopDist(rng);
+            }
+            out << '\n';
+        }
+    }
+
+    // Построчно: каждая строка разбирается как команда CREATE_TRL
+    initializeStorage();
+    auto start = chrono::steady_clock::now();
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        istringstream iss(line);
+        string trolleyName, stop;
+        iss >> trolleyName;
+        vector<string> route;
+        while (iss >> stop) {
+            route.push_back(stop);
+        }
+        addTrolleyRoute(trolleyName, route);
+    }
+    double lineMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    auto expectedTrolleys = getAllTrolleys();
+    map<string, map<string, set<string>>> expectedTransfers;
+    for (const auto& entry : expectedTrolleys) {
+        expectedTransfers[entry.first] = getStopsForTrolley(entry.first);
+    }
+
+    // Загрузка файла целиком
+    initializeStorage();
+    LoadResult result;
+    start = chrono::steady_clock::now();
+    bool loaded = loadRoutes(path, result);
+    double bulkMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    remove(path.c_str());
+
+    bool same = loaded && getAllTrolleys() == expectedTrolleys;
+    for (const auto& entry : expectedTransfers) {
+        same = same && getStopsForTrolley(entry.first) == entry.second;
+    }
+
+    cout << "Trolleys: " << trolleys << ", stops: " << result.stops << endl;
+    cout << "CREATE_TRL lines: " << lineMs << " ms" << endl;
+    cout << "Bulk load: " << bulkMs << " ms" << (same ? "" : " (results differ!)") << endl;
+}
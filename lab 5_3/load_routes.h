@@ -0,0 +1,17 @@
+#ifndef LOAD_ROUTES_H
+#define LOAD_ROUTES_H
+
+#include <string>
+#include "concurrent_storage.h"
+
+using namespace std;
+
+// Загрузка маршрутов из файла (строка файла - "троллейбус остановка1 ... остановкаN")
+// storage - хранилище, path - путь к файлу
+void executeLoadRoutes(ConcurrentStorage& storage, const string& path);
+
+// Сравнение загрузки файла с добавлением тех же маршрутов командами CREATE_TRL
+// trolleys - количество троллейбусов, stops - количество остановок
+void runLoadBenchmark(int trolleys, int stops);
+
+#endif // LOAD_ROUTES_H
@@ -1,10 +1,15 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <cstring>
+#include <cstdlib>
 #include "create_trl.h"
 #include "trl_in_stop.h"
 #include "stops_in_trl.h"
 #include "trls.h"
+#include "route.h"
+#include "load_routes.h"
+#include "concurrent_storage.h"
 #include "storage.h"
 
 using namespace std;
@@ -15,6 +20,8 @@ enum class CommandType {
     TRL_IN_STOP,   // Троллейбусы на остановке
     STOPS_IN_TRL,  // Остановки троллейбуса
     TRLS,          // Все троллейбусы
+    ROUTE,         // Поездка между остановками
+    LOAD,          // Загрузка маршрутов из файла
     UNKNOWN        // Неизвестная команда
 };
 
@@ -24,11 +31,14 @@ CommandType parseCommandType(const string& commandStr) {
     if (commandStr == "TRL_IN_STOP") return CommandType::TRL_IN_STOP;
     if (commandStr == "STOPS_IN_TRL") return CommandType::STOPS_IN_TRL;
     if (commandStr == "TRLS") return CommandType::TRLS;
+    if (commandStr == "ROUTE") return CommandType::ROUTE;
+    if (commandStr == "LOAD") return CommandType::LOAD;
     return CommandType::UNKNOWN;
 }
 
-// Обработка введенной команды
-void processCommand(const string& commandLine) {
+// Обработка введенной команды: чтение - по снимку через ячейку reader,
+// изменения - через писателя хранилища с публикацией новой версии
+void processCommand(ConcurrentStorage& storage, int reader, const string& commandLine) {
     istringstream iss(commandLine);
     string commandStr;
     iss >> commandStr;  // Извлекаем первое слово (команду)
@@ -49,26 +59,48 @@ void processCommand(const string& commandLine) {
                 stops.push_back(stop);
             }
             
-            executeCreateTrolley(trolleyName, stops);
+            executeCreateTrolley(storage, trolleyName, stops);
             break;
         }
         
         case CommandType::TRL_IN_STOP: {
             string stop;
             iss >> stop;  // Извлекаем название остановки
-            executeTrolleysInStop(stop);
+            storage.read(reader, [&](const NetworkSnapshot& snapshot) {
+                executeTrolleysInStop(snapshot, stop);
+            });
             break;
         }
         
         case CommandType::STOPS_IN_TRL: {
             string trolleyName;
             iss >> trolleyName;  // Извлекаем название троллейбуса
-            executeStopsInTrolley(trolleyName);
+            storage.read(reader, [&](const NetworkSnapshot& snapshot) {
+                executeStopsInTrolley(snapshot, trolleyName);
+            });
             break;
         }
         
         case CommandType::TRLS: {
-            executeListAllTrolleys();
+            storage.read(reader, [&](const NetworkSnapshot& snapshot) {
+                executeListAllTrolleys(snapshot);
+            });
+            break;
+        }
+        
+        case CommandType::ROUTE: {
+            string from, to;
+            iss >> from >> to;  // Извлекаем начальную и конечную остановки
+            // Поиск перестраивает граф пересадок по основному хранилищу,
+            // поэтому выполняется в потоке писателя, а не по снимку
+            executeRoute(from, to);
+            break;
+        }
+        
+        case CommandType::LOAD: {
+            string path;
+            iss >> path;  // Извлекаем путь к файлу маршрутов
+            executeLoadRoutes(storage, path);
             break;
         }
         
@@ -79,9 +111,34 @@ void processCommand(const string& commandLine) {
     }
 }
 
-int main() {
-    // Инициализация хранилища
+int main(int argc, char* argv[]) {
+    // Режим бенчмарка: lab_5.3 --bench-route [остановок] [троллейбусов] [запросов]
+    if (argc > 1 && strcmp(argv[1], "--bench-route") == 0) {
+        runRouteBenchmark(argc > 2 ? atoi(argv[2]) : 10000,
+                          argc > 3 ? atoi(argv[3]) : 1000,
+                          argc > 4 ? atoi(argv[4]) : 100000);
+        return 0;
+    }
+
+    // Бенчмарк загрузки: lab_5.3 --bench-load [троллейбусов] [остановок]
+    if (argc > 1 && strcmp(argv[1], "--bench-load") == 0) {
+        runLoadBenchmark(argc > 2 ? atoi(argv[2]) : 5000,
+                         argc > 3 ? atoi(argv[3]) : 20000);
+        return 0;
+    }
+
+    // Одновременное чтение и запись: lab_5.3 --bench-concurrent [читателей] [троллейбусов] [остановок]
+    if (argc > 1 && strcmp(argv[1], "--bench-concurrent") == 0) {
+        runConcurrentBenchmark(argc > 2 ? atoi(argv[2]) : 8,
+                               argc > 3 ? atoi(argv[3]) : 2000,
+                               argc > 4 ? atoi(argv[4]) : 10000);
+        return 0;
+    }
+
+    // Инициализация хранилища и ячейка читателя для команд чтения
     initializeStorage();
+    ConcurrentStorage storage;
+    int reader = storage.registerReader();
     
     // Приветственное сообщение
     cout << "Trolley route management system" << endl;
@@ -90,6 +147,8 @@ int main() {
     cout << "TRL_IN_STOP stop" << endl;
     cout << "STOPS_IN_TRL trl" << endl;
     cout << "TRLS" << endl;
+    cout << "ROUTE from to" << endl;
+    cout << "LOAD file" << endl;
     cout << "Enter 'exit' to quit" << endl << endl;
     
     // Основной цикл обработки команд
@@ -105,9 +164,10 @@ int main() {
         
         // Обработка непустой команды
         if (!commandLine.empty()) {
-            processCommand(commandLine);
+            processCommand(storage, reader, commandLine);
         }
     }
     
+    storage.unregisterReader(reader);
     return 0;
 }
@@ -0,0 +1,99 @@
+#include "route.h"
+#include "storage.h"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+
+using namespace std;
+
+// Обработка команды поиска поездки
+void executeRoute(const string& from, const string& to) {
+    // Буфер участков переиспользуется между запросами
+    static vector<JourneyLeg> legs;
+
+    if (!findJourney(from, to, legs)) {
+        cout << "No route from " << from << " to " << to << endl;
+        return;
+    }
+
+    // Пересадок на одну меньше, чем поездок
+    int stops = 0;
+    for (const auto& leg : legs) {
+        stops += leg.stops;
+    }
+    size_t transfers = legs.empty() ? 0 : legs.size() - 1;
+    cout << "Route from " << from << " to " << to << " (transfers: " << transfers
+         << ", stops: " << stops << "):" << '\n';
+    for (const auto& leg : legs) {
+        cout << "- trolley " << leg.trolley << ": " << leg.from << " -> " << leg.to
+             << " (" << leg.stops << " stops)" << '\n';
+    }
+    cout << flush;
+}
+
+// Замер скорости поиска поездок. Остановки - узлы квадратной сетки,
+// маршруты - случайные пути по сетке без разворотов
+void runRouteBenchmark(int stops, int trolleys, int queries) {
+    mt19937 rng(42);
+    int side = 1;
+    while (side * side < stops) {
+        side++;
+    }
+    stops = side * side;
+    auto stopName = [](int stop) { return "S" + to_string(stop); };
+
+    initializeStorage();
+    uniform_int_distribution<int> stopDist(0, stops - 1);
+    uniform_int_distribution<int> lengthDist(15, 40);
+    const int dx[] = {1, -1, 0, 0};
+    const int dy[] = {0, 0, 1, -1};
+    for (int t = 0; t < trolleys; ++t) {
+        vector<string> route;
+        int stop = stopDist(rng);
+        int direction = static_cast<int>(rng() % 4);
+        int length = lengthDist(rng);
+        for (int i = 0; i < length; ++i) {
+            route.push_back(stopName(stop));
+            // Чаще едем прямо, иногда поворачиваем; у края сетки - любой допустимый ход
+            for (int attempt = 0; attempt < 8; ++attempt) {
+                int next = attempt == 0 && rng() % 4 != 0 ? direction : static_cast<int>(rng() % 4);
+                if ((direction ^ next) == 1) {
+                    continue;  // Разворот назад
+                }
+                int x = stop % side + dx[next];
+                int y = stop / side + dy[next];
+                if (x >= 0 && x < side && y >= 0 && y < side) {
+                    direction = next;
+                    stop = y * side + x;
+                    break;
+                }
+            }
+        }
+        addTrolleyRoute("T" + to_string(t + 1), route);
+    }
+
+    vector<pair<string, string>> pairs(queries);
+    for (auto& query : pairs) {
+        query = {stopName(stopDist(rng)), stopName(stopDist(rng))};
+    }
+
+    vector<JourneyLeg> legs;
+    int found = 0;
+    size_t totalLegs = 0;
+    auto start = chrono::steady_clock::now();
+    for (const auto& query : pairs) {
+        if (findJourney(query.first, query.second, legs)) {
+            found++;
+            totalLegs += legs.size();
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Stops: " << stops << ", trolleys: " << trolleys << ", queries: " << queries << endl;
+    cout << "Found: " << found << ", average trips: "
+         << (found > 0 ? static_cast<double>(totalLegs) / found : 0.0) << endl;
+    cout << "Time: " << seconds * 1000 << " ms, " << seconds * 1e6 / max(queries, 1)
+         << " us per query, " << static_cast<long long>(queries / max(seconds, 1e-9))
+         << " queries/s" << endl;
+}
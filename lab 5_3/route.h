@@ -0,0 +1,18 @@
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <string>
+
+using namespace std;
+
+// Поиск поездки между остановками с наименьшим числом пересадок
+// from - начальная остановка
+// to - конечная остановка
+void executeRoute(const string& from, const string& to);
+
+// Замер скорости поиска поездок на случайной сети
+// stops - количество остановок, trolleys - количество троллейбусов,
+// queries - количество запросов
+void runRouteBenchmark(int stops, int trolleys, int queries);
+
+#endif // ROUTE_H
@@ -1,26 +1,29 @@
 #include "stops_in_trl.h"
-#include "storage.h"
 #include <iostream>
 
 using namespace std;
 
 // Обработка команды получения остановок троллейбуса
-void executeStopsInTrolley(const string& trolleyName) {
-    // Получаем информацию об остановках
-    auto stopsInfo = getStopsForTrolley(trolleyName);
-    
+void executeStopsInTrolley(const NetworkSnapshot& snapshot, const string& trolleyName) {
+    // Для каждой остановки с пересадками выводим возможные пересадки
+    // прямо из снимка; заголовок - перед первой такой остановкой
+    bool first = true;
+    size_t count = snapshot.forEachTransfer(trolleyName, [&](const string& stop, const NameList& trolleys) {
+        if (first) {
+            cout << "Stops for trolley " << trolleyName << " with connecting trolleys:" << '\n';
+            first = false;
+        }
+        cout << "- " << stop << " (connecting trolleys: ";
+        for (const auto& trolley : trolleys) {
+            cout << trolley << " ";
+        }
+        cout << ")" << '\n';
+    });
+
     // Выводим результат
-    if (stopsInfo.empty()) {
+    if (count == 0) {
         cout << "No information available for trolley " << trolleyName << endl;
     } else {
-        cout << "Stops for trolley " << trolleyName << " with connecting trolleys:" << endl;
-        // Для каждой остановки выводим возможные пересадки
-        for (const auto& [stop, trolleys] : stopsInfo) {
-            cout << "- " << stop << " (connecting trolleys: ";
-            for (const auto& trolley : trolleys) {
-                cout << trolley << " ";
-            }
-            cout << ")" << endl;
-        }
+        cout << flush;
     }
 }
@@ -2,11 +2,12 @@
 #define STOPS_IN_TRL_H
 
 #include <string>
+#include "storage.h"
 
 using namespace std;
 
 // Получение информации об остановках троллейбуса с пересадками
-// trolleyName - название троллейбуса
-void executeStopsInTrolley(const string& trolleyName);
+// snapshot - версия хранилища, trolleyName - название троллейбуса
+void executeStopsInTrolley(const NetworkSnapshot& snapshot, const string& trolleyName);
 
 #endif // STOPS_IN_TRL_H
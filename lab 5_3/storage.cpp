@@ -1,82 +1,846 @@
 #include "storage.h"
 #include <algorithm>
+#include <unordered_map>
+#include <climits>
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace std;
 
-// Внутренние структуры для хранения данных
+// Поиск номера названия: пробы по таблице поиска до пустой ячейки
+int NameTable::find(const string& name) const {
+    const Index* current = index.load(memory_order_acquire);
+    if (current == nullptr) {
+        return -1;
+    }
+    for (size_t slot = hash<string>()(name) & current->mask;; slot = (slot + 1) & current->mask) {
+        const Entry* entry = current->slots[slot].load(memory_order_acquire);
+        if (entry == nullptr) {
+            return -1;
+        }
+        if (entry->name == name) {
+            return entry->id;
+        }
+    }
+}
+
+// Добавление названия. Таблица поиска заполняется не больше чем наполовину;
+// запись публикуется в ячейке поиска после того, как полностью построена
+int NameTable::intern(const string& name) {
+    int known = find(name);
+    if (known >= 0) {
+        return known;
+    }
+    const Index* current = index.load(memory_order_relaxed);
+    if (current == nullptr || (entries.size() + 1) * 2 > current->mask + 1) {
+        size_t capacity = current == nullptr ? 64 : (current->mask + 1) * 2;
+        auto grown = make_unique<Index>();
+        grown->mask = capacity - 1;
+        grown->slots = make_unique<atomic<const Entry*>[]>(capacity);
+        grown->byId = make_unique<const Entry*[]>(capacity / 2);
+        for (const Entry& entry : entries) {
+            size_t slot = hash<string>()(entry.name) & grown->mask;
+            while (grown->slots[slot].load(memory_order_relaxed) != nullptr) {
+                slot = (slot + 1) & grown->mask;
+            }
+            grown->slots[slot].store(&entry, memory_order_relaxed);
+            grown->byId[entry.id] = &entry;
+        }
+        indexes.push_back(move(grown));
+        current = indexes.back().get();
+        index.store(current, memory_order_release);
+    }
+
+    int id = static_cast<int>(entries.size());
+    entries.push_back({name, id});
+    const Entry* entry = &entries.back();
+    indexes.back()->byId[id] = entry;
+    size_t slot = hash<string>()(name) & current->mask;
+    while (current->slots[slot].load(memory_order_relaxed) != nullptr) {
+        slot = (slot + 1) & current->mask;
+    }
+    current->slots[slot].store(entry, memory_order_release);
+    return id;
+}
+
+void NameTable::clear() {
+    index.store(nullptr);
+    indexes.clear();
+    entries.clear();
+}
+
+// Внутренние структуры для хранения данных.
+// Названия остановок и троллейбусов хранятся по одному разу и заменяются
+// плотными целыми номерами; маршруты и связи остановка - троллейбусы
+// хранятся как векторы номеров в текущей версии сети
 namespace {
-    // Основное хранилище маршрутов: троллейбус - остановки
-    map<string, vector<string>> trolleyRoutes;
-    
-    // Хранилище для быстрого поиска: остановка - троллейбусы
-    map<string, set<string>> stopToTrolleys;
+    // Названия по номеру и номер по названию (общие для всех версий)
+    NameTable trolleyNames;
+    NameTable stopNames;
+
+    // Текущая версия: маршруты, троллейбусы остановок (по названию
+    // троллейбуса), все троллейбусы по названию и индекс пересадок - для
+    // каждого троллейбуса остановки его маршрута, где есть пересадки, по
+    // названию остановки. Индекс пересадок обновляется при изменении
+    // маршрутов, поэтому STOPS_IN_TRL только читает его
+    NetworkSnapshot network;
+
+    // Пересадка на остановке маршрута: другие троллейбусы на ней по названию
+    using Transfer = NetworkSnapshot::Transfer;
+
+    // Граф пересадок между троллейбусами в виде CSR: соседи троллейбуса t -
+    // transferNeighbors[transferOffsets[t] .. transferOffsets[t + 1]).
+    // Перестраивается при первом поиске после изменения маршрутов
+    vector<int> transferOffsets;
+    vector<int> transferNeighbors;
+    vector<int> trolleyComponent;       // Компонента связности графа пересадок
+    bool transferGraphDirty = true;
+
+    // Поиск поездки: сначала обход графа пересадок в ширину дает наименьшее
+    // число поездок и троллейбусы, лежащие на кратчайших цепочках пересадок;
+    // затем раунды (как в RAPTOR) только по этим троллейбусам находят
+    // наименьшее число перегонов. В раунде k известно наименьшее число
+    // перегонов до каждой остановки не более чем с k поездками.
+    // Буферы переиспользуются между запросами
+    const int UNREACHED = INT_MAX;
+
+    // Поездка, улучшившая остановку в раунде: троллейбус и позиции посадки
+    // и высадки в его маршруте
+    struct Ride {
+        int trolley;
+        int board;
+        int alight;
+    };
+
+    vector<vector<int>> roundArrival;   // [раунд][остановка] - перегонов до остановки
+    vector<vector<Ride>> roundRide;     // [раунд][остановка] - поездка, улучшившая остановку
+    vector<vector<int>> sourceLayers;   // [d] - троллейбусы в d пересадках от начала
+    vector<int> distanceToTarget;       // Пересадок от троллейбуса до конечной остановки
+    vector<int> sourceMark;             // Метка запроса: троллейбус достигнут от начала
+    vector<int> targetMark;             // Метка запроса: троллейбус проходит через конец
+    vector<int> targetSeen;             // Метка запроса: расстояние до конца известно
+    vector<int> searchQueue;            // Очередь обхода в ширину
+    int searchMark = 0;                 // Счетчик меток
+
+    // Сравнение троллейбусов по названию
+    bool trolleyNameLess(int a, int b) {
+        return trolleyNames[a] < trolleyNames[b];
+    }
+
+    // Сравнение остановок по названию
+    bool stopNameLess(int a, int b) {
+        return stopNames[a] < stopNames[b];
+    }
+
+    // Список текущей версии для изменения. Разделенный со снимком список
+    // сначала копируется. Снимки создает и удаляет только писатель, а
+    // читатели указатели не копируют, поэтому счетчик ссылок точен
+    template <typename T>
+    T& edit(shared_ptr<T>& list) {
+        if (list.use_count() > 1) {
+            list = make_shared<T>(*list);
+        }
+        return *list;
+    }
+
+    // Вставка номера троллейбуса в упорядоченный по названию список (без повторов)
+    void insertTrolley(vector<int>& trolleys, int trolley) {
+        auto it = lower_bound(trolleys.begin(), trolleys.end(), trolley, trolleyNameLess);
+        if (it == trolleys.end() || *it != trolley) {
+            trolleys.insert(it, trolley);
+        }
+    }
+
+    // Удаление номера троллейбуса из упорядоченного по названию списка
+    void eraseTrolley(vector<int>& trolleys, int trolley) {
+        auto it = lower_bound(trolleys.begin(), trolleys.end(), trolley, trolleyNameLess);
+        if (it != trolleys.end() && *it == trolley) {
+            trolleys.erase(it);
+        }
+    }
+
+    // Остановки маршрута без повторов, по названию
+    vector<int> distinctStops(const vector<int>& route) {
+        vector<int> stops = route;
+        sort(stops.begin(), stops.end());
+        stops.erase(unique(stops.begin(), stops.end()), stops.end());
+        sort(stops.begin(), stops.end(), stopNameLess);
+        return stops;
+    }
+
+    // Место пересадки на остановке stop в упорядоченном списке пересадок
+    vector<Transfer>::iterator lowerTransfer(vector<Transfer>& list, int stop) {
+        return lower_bound(list.begin(), list.end(), stop, [](const Transfer& transfer, int value) {
+            return stopNameLess(transfer.stop, value);
+        });
+    }
+
+    // Есть ли в списке пересадка на остановке stop
+    bool hasTransfer(const vector<Transfer>& list, int stop) {
+        auto it = lower_bound(list.begin(), list.end(), stop, [](const Transfer& transfer, int value) {
+            return stopNameLess(transfer.stop, value);
+        });
+        return it != list.end() && it->stop == stop;
+    }
+
+    // Номер по названию в версии, где count названий, -1 если такого названия
+    // в ней нет (названия, добавленные позже, версии не видны)
+    int findId(const NameTable& names, size_t count, const string& name) {
+        int id = names.find(name);
+        return id >= 0 && static_cast<size_t>(id) < count ? id : -1;
+    }
+
+    // Номер остановки; новая остановка получает следующий свободный номер
+    int internStop(const string& stop) {
+        int id = stopNames.intern(stop);
+        if (static_cast<size_t>(id) == network.stopToTrolleys.size()) {
+            network.stopToTrolleys.push_back(make_shared<vector<int>>());
+        }
+        return id;
+    }
+
+    // Номер троллейбуса; новый троллейбус добавляется в список по названию
+    int internTrolley(const string& trolleyName) {
+        int id = trolleyNames.intern(trolleyName);
+        if (static_cast<size_t>(id) == network.trolleyRoutes.size()) {
+            network.trolleyRoutes.push_back(make_shared<vector<int>>());
+            network.transfers.push_back(make_shared<vector<Transfer>>());
+            auto& byName = edit(network.trolleysByName);
+            byName.insert(upper_bound(byName.begin(), byName.end(), id, trolleyNameLess), id);
+        }
+        return id;
+    }
 }
 
 // Инициализация хранилища (очистка всех данных)
 void initializeStorage() {
-    trolleyRoutes.clear();
-    stopToTrolleys.clear();
+    trolleyNames.clear();
+    stopNames.clear();
+    network = NetworkSnapshot();
+    transferGraphDirty = true;
 }
 
-// Добавление маршрута троллейбуса
+// Добавление маршрута троллейбуса. Меняются только списки, которых касается
+// маршрут: его остановки и троллейбусы на них
 void addTrolleyRoute(const string& trolleyName, const vector<string>& stops) {
-    // Проверяем, существует ли уже такой троллейбус
-    auto it = trolleyRoutes.find(trolleyName);
-    if (it != trolleyRoutes.end()) {
-        // Удаляем старые связи остановок с этим троллейбусом
-        for (const auto& stop : it->second) {
-            stopToTrolleys[stop].erase(trolleyName);
-            // Если для остановки больше нет троллейбусов, удаляем её
-            if (stopToTrolleys[stop].empty()) {
-                stopToTrolleys.erase(stop);
+    int trolley = internTrolley(trolleyName);
+    transferGraphDirty = true;
+
+    // Удаляем старые связи остановок с этим троллейбусом и его пересадки
+    // из индекса остальных троллейбусов этих остановок
+    for (int stop : distinctStops(*network.trolleyRoutes[trolley])) {
+        eraseTrolley(edit(network.stopToTrolleys[stop]), trolley);
+        for (int other : *network.stopToTrolleys[stop]) {
+            if (!hasTransfer(*network.transfers[other], stop)) {
+                continue;
+            }
+            auto& list = edit(network.transfers[other]);
+            auto it = lowerTransfer(list, stop);
+            eraseTrolley(it->trolleys, trolley);
+            if (it->trolleys.empty()) {
+                list.erase(it);
             }
         }
     }
-    
+
     // Добавляем новый маршрут
-    trolleyRoutes[trolleyName] = stops;
-    
-    // Обновляем информацию по остановкам
+    auto route = make_shared<vector<int>>();
+    route->reserve(stops.size());
     for (const auto& stop : stops) {
-        stopToTrolleys[stop].insert(trolleyName);
+        route->push_back(internStop(stop));
     }
+    network.trolleyRoutes[trolley] = route;
+
+    // Обновляем информацию по остановкам (остановка может повторяться в маршруте)
+    // и индекс пересадок: этот троллейбус становится пересадкой для остальных
+    // троллейбусов его остановок, а они - для него
+    auto own = make_shared<vector<Transfer>>();
+    for (int stop : distinctStops(*route)) {
+        auto& trolleys = edit(network.stopToTrolleys[stop]);
+        for (int other : trolleys) {
+            auto& list = edit(network.transfers[other]);
+            auto it = lowerTransfer(list, stop);
+            if (it == list.end() || it->stop != stop) {
+                it = list.insert(it, Transfer{stop, {}});
+            }
+            insertTrolley(it->trolleys, trolley);
+        }
+        if (!trolleys.empty()) {
+            own->push_back({stop, trolleys});
+        }
+        insertTrolley(trolleys, trolley);
+    }
+    network.transfers[trolley] = own;
 }
 
 // Получение троллейбусов для остановки
 set<string> getTrolleysForStop(const string& stop) {
-    auto it = stopToTrolleys.find(stop);
+    set<string> result;
     // Если остановка найдена, возвращаем список троллейбусов, если нет то пустое множество
-    return it != stopToTrolleys.end() ? it->second : set<string>{};
+    for (const auto& trolley : trolleysAtStop(stop)) {
+        result.insert(result.end(), trolley);
+    }
+    return result;
 }
 
 // Получение информации об остановках троллейбуса
 map<string, set<string>> getStopsForTrolley(const string& trolleyName) {
     map<string, set<string>> result;
-    
-    // Ищем троллейбус в системе
-    auto it = trolleyRoutes.find(trolleyName);
-    if (it != trolleyRoutes.end()) {
-        // Для каждой остановки этого троллейбуса
-        for (const auto& stop : it->second) {
-            set<string> trolleysAtStop;
-            // Находим все троллейбусы на этой остановке
-            for (const auto& trolley : stopToTrolleys[stop]) {
-                // Исключаем текущий троллейбус из результата
-                if (trolley != trolleyName) {
-                    trolleysAtStop.insert(trolley);
+
+    // Пересадки троллейбуса берем из индекса
+    forEachTransfer(trolleyName, [&](const string& stop, const NameList& trolleys) {
+        auto& names = result[stop];
+        for (const auto& trolley : trolleys) {
+            names.insert(names.end(), trolley);
+        }
+    });
+
+    return result;
+}
+
+// Получение информации о всех троллейбусах
+map<string, vector<string>> getAllTrolleys() {
+    map<string, vector<string>> result;
+    forEachTrolley([&](const string& trolley, const NameList& stops) {
+        vector<string> names;
+        names.reserve(stops.size());
+        for (const auto& stop : stops) {
+            names.push_back(stop);
+        }
+        result.emplace_hint(result.end(), trolley, move(names));
+    });
+    return result;
+}
+
+// Функции чтения хранилища - чтение текущей версии
+NameList trolleysAtStop(const string& stop) {
+    return network.trolleysAtStop(stop);
+}
+
+NameList stopsOfTrolley(const string& trolleyName) {
+    return network.stopsOfTrolley(trolleyName);
+}
+
+size_t trolleyCount() {
+    return network.trolleyCount();
+}
+
+void forEachTrolley(const function<void(const string&, const NameList&)>& visit) {
+    network.forEachTrolley(visit);
+}
+
+size_t forEachTransfer(const string& trolleyName,
+                       const function<void(const string&, const NameList&)>& visit) {
+    return network.forEachTransfer(trolleyName, visit);
+}
+
+// Снимок текущего состояния хранилища
+unique_ptr<NetworkSnapshot> makeSnapshot() {
+    return make_unique<NetworkSnapshot>(network);
+}
+
+// Троллейбусы на остановке без копирования
+NameList NetworkSnapshot::trolleysAtStop(const string& stop) const {
+    int id = findId(stopNames, stopToTrolleys.size(), stop);
+    return id >= 0 ? NameList(stopToTrolleys[id].get(), &trolleyNames) : NameList();
+}
+
+// Остановки троллейбуса без копирования
+NameList NetworkSnapshot::stopsOfTrolley(const string& trolleyName) const {
+    int id = findId(trolleyNames, trolleyRoutes.size(), trolleyName);
+    return id >= 0 ? NameList(trolleyRoutes[id].get(), &stopNames) : NameList();
+}
+
+// Обход всех троллейбусов
+void NetworkSnapshot::forEachTrolley(const function<void(const string&, const NameList&)>& visit) const {
+    for (int trolley : *trolleysByName) {
+        visit(trolleyNames[trolley], NameList(trolleyRoutes[trolley].get(), &stopNames));
+    }
+}
+
+// Обход остановок троллейбуса с пересадками (только чтение индекса)
+size_t NetworkSnapshot::forEachTransfer(const string& trolleyName,
+                                        const function<void(const string&, const NameList&)>& visit) const {
+    int id = findId(trolleyNames, transfers.size(), trolleyName);
+    if (id < 0) {
+        return 0;
+    }
+    for (const auto& transfer : *transfers[id]) {
+        visit(stopNames[transfer.stop], NameList(&transfer.trolleys, &trolleyNames));
+    }
+    return transfers[id]->size();
+}
+
+// Перестройка графа пересадок и его компонент связности
+static void buildTransferGraph() {
+    size_t count = network.trolleyRoutes.size();
+    transferOffsets.assign(1, 0);
+    transferNeighbors.clear();
+    sourceMark.assign(count, 0);
+    targetMark.assign(count, 0);
+    targetSeen.assign(count, 0);
+    distanceToTarget.assign(count, 0);
+    searchMark = 0;
+
+    // Соседи - троллейбусы, имеющие общую остановку
+    for (size_t trolley = 0; trolley < count; ++trolley) {
+        int mark = ++searchMark;
+        sourceMark[trolley] = mark;
+        for (int stop : *network.trolleyRoutes[trolley]) {
+            for (int other : *network.stopToTrolleys[stop]) {
+                if (sourceMark[other] != mark) {
+                    sourceMark[other] = mark;
+                    transferNeighbors.push_back(other);
                 }
             }
-            // Добавляем в результат только остановки с пересадками
-            if (!trolleysAtStop.empty()) {
-                result[stop] = trolleysAtStop;
+        }
+        transferOffsets.push_back(static_cast<int>(transferNeighbors.size()));
+    }
+
+    trolleyComponent.assign(count, -1);
+    int components = 0;
+    for (size_t start = 0; start < count; ++start) {
+        if (trolleyComponent[start] >= 0) {
+            continue;
+        }
+        searchQueue.assign(1, static_cast<int>(start));
+        trolleyComponent[start] = components;
+        for (size_t head = 0; head < searchQueue.size(); ++head) {
+            int trolley = searchQueue[head];
+            for (int i = transferOffsets[trolley]; i < transferOffsets[trolley + 1]; ++i) {
+                int other = transferNeighbors[i];
+                if (trolleyComponent[other] < 0) {
+                    trolleyComponent[other] = components;
+                    searchQueue.push_back(other);
+                }
             }
         }
+        components++;
     }
-    
-    return result;
+    transferGraphDirty = false;
 }
 
-// Получение информации о всех троллейбусах
-map<string, vector<string>> getAllTrolleys() {
-    return trolleyRoutes;
+// Поиск поездки с наименьшим числом пересадок
+bool findJourney(const string& from, const string& to, vector<JourneyLeg>& legs) {
+    legs.clear();
+    int source = stopNames.find(from);
+    int target = stopNames.find(to);
+    if (source < 0 || target < 0) {
+        return false;
+    }
+
+    // Остановка, с которой сняли все маршруты, остается в таблице названий,
+    // но поездки через нее нет - даже на ту же остановку
+    const vector<int>& startTrolleys = *network.stopToTrolleys[source];
+    const vector<int>& endTrolleys = *network.stopToTrolleys[target];
+    if (startTrolleys.empty() || endTrolleys.empty()) {
+        return false;
+    }
+    if (source == target) {
+        return true;
+    }
+    if (transferGraphDirty) {
+        buildTransferGraph();
+    }
+
+    // Остановки в разных компонентах графа пересадок не связаны
+    int mark = ++searchMark;
+    for (int trolley : endTrolleys) {
+        targetMark[trolley] = mark;
+    }
+    bool connected = false;
+    for (int trolley : startTrolleys) {
+        for (int other : endTrolleys) {
+            connected = connected || trolleyComponent[trolley] == trolleyComponent[other];
+        }
+    }
+    if (!connected) {
+        return false;
+    }
+
+    // Обход в ширину от троллейбусов начальной остановки по слоям, пока
+    // слой не содержит троллейбус конечной остановки: depth пересадок
+    if (sourceLayers.empty()) {
+        sourceLayers.resize(1);
+    }
+    sourceLayers[0] = startTrolleys;
+    for (int trolley : startTrolleys) {
+        sourceMark[trolley] = mark;
+    }
+    size_t depth = 0;
+    while (true) {
+        bool reached = false;
+        for (int trolley : sourceLayers[depth]) {
+            reached = reached || targetMark[trolley] == mark;
+        }
+        if (reached) {
+            break;
+        }
+        if (sourceLayers.size() <= depth + 1) {
+            sourceLayers.resize(depth + 2);
+        }
+        vector<int>& next = sourceLayers[depth + 1];
+        next.clear();
+        for (int trolley : sourceLayers[depth]) {
+            for (int i = transferOffsets[trolley]; i < transferOffsets[trolley + 1]; ++i) {
+                int other = transferNeighbors[i];
+                if (sourceMark[other] != mark) {
+                    sourceMark[other] = mark;
+                    next.push_back(other);
+                }
+            }
+        }
+        depth++;
+    }
+
+    // Обратный обход от троллейбусов конечной остановки: только по
+    // троллейбусам, достигнутым прямым обходом, не глубже depth
+    searchQueue.clear();
+    for (int trolley : endTrolleys) {
+        if (sourceMark[trolley] == mark) {
+            targetSeen[trolley] = mark;
+            distanceToTarget[trolley] = 0;
+            searchQueue.push_back(trolley);
+        }
+    }
+    for (size_t head = 0; head < searchQueue.size(); ++head) {
+        int trolley = searchQueue[head];
+        int distance = distanceToTarget[trolley];
+        if (static_cast<size_t>(distance) == depth) {
+            continue;
+        }
+        for (int i = transferOffsets[trolley]; i < transferOffsets[trolley + 1]; ++i) {
+            int other = transferNeighbors[i];
+            if (sourceMark[other] == mark && targetSeen[other] != mark) {
+                targetSeen[other] = mark;
+                distanceToTarget[other] = distance + 1;
+                searchQueue.push_back(other);
+            }
+        }
+    }
+
+    // Раунды по поездкам: в раунде round участвуют троллейбусы, лежащие на
+    // кратчайшей цепочке пересадок на позиции round - 1
+    size_t stopCount = network.stopToTrolleys.size();
+    size_t rounds = depth + 1;
+    if (roundArrival.size() <= rounds) {
+        roundArrival.resize(rounds + 1);
+        roundRide.resize(rounds + 1);
+    }
+    roundArrival[0].assign(stopCount, UNREACHED);
+    roundArrival[0][source] = 0;
+    for (size_t round = 1; round <= rounds; ++round) {
+        roundArrival[round] = roundArrival[round - 1];
+        roundRide[round].resize(stopCount);
+        const vector<int>& previous = roundArrival[round - 1];
+        vector<int>& current = roundArrival[round];
+
+        // Проезд по маршруту в обе стороны: посадка на остановке
+        // с наименьшим (перегонов до нее - позиция), высадка на любой дальше
+        auto improve = [&](int stop, int arrival, const Ride& ride) {
+            if (arrival < current[stop] && arrival < current[target]) {
+                current[stop] = arrival;
+                roundRide[round][stop] = ride;
+            }
+        };
+        for (int trolley : sourceLayers[round - 1]) {
+            if (targetSeen[trolley] != mark
+                || static_cast<size_t>(distanceToTarget[trolley]) != rounds - round) {
+                continue;
+            }
+            const vector<int>& route = *network.trolleyRoutes[trolley];
+            int length = static_cast<int>(route.size());
+
+            int boardValue = UNREACHED, boardPosition = -1;
+            for (int position = 0; position < length; ++position) {
+                int stop = route[position];
+                if (boardPosition >= 0) {
+                    improve(stop, boardValue + position, {trolley, boardPosition, position});
+                }
+                if (previous[stop] != UNREACHED && previous[stop] - position < boardValue) {
+                    boardValue = previous[stop] - position;
+                    boardPosition = position;
+                }
+            }
+
+            boardValue = UNREACHED;
+            boardPosition = -1;
+            for (int position = length - 1; position >= 0; --position) {
+                int stop = route[position];
+                if (boardPosition >= 0) {
+                    improve(stop, boardValue - position, {trolley, boardPosition, position});
+                }
+                if (previous[stop] != UNREACHED && previous[stop] + position < boardValue) {
+                    boardValue = previous[stop] + position;
+                    boardPosition = position;
+                }
+            }
+        }
+    }
+    if (roundArrival[rounds][target] == UNREACHED) {
+        return false;
+    }
+
+    // Восстановление участков от конечной остановки назад
+    int stop = target;
+    size_t k = rounds;
+    while (stop != source) {
+        // Раунд, в котором остановка получила используемое значение
+        while (k > 1 && roundArrival[k - 1][stop] == roundArrival[k][stop]) {
+            k--;
+        }
+        const Ride& ride = roundRide[k][stop];
+        const vector<int>& route = *network.trolleyRoutes[ride.trolley];
+        int boardStop = route[ride.board];
+        legs.push_back({trolleyNames[ride.trolley], stopNames[boardStop], stopNames[stop],
+                        abs(ride.alight - ride.board)});
+        stop = boardStop;
+        k--;
+    }
+    reverse(legs.begin(), legs.end());
+    return true;
+}
+
+// Файл, отображенный в память только для чтения
+namespace {
+    class MappedFile {
+    public:
+        ~MappedFile() {
+            if (data != nullptr) {
+                munmap(const_cast<char*>(data), size);
+            }
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        bool open(const string& path) {
+            fd = ::open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if (fd < 0 || fstat(fd, &info) != 0) {
+                return false;
+            }
+            size = static_cast<size_t>(info.st_size);
+            if (size == 0) {
+                return true;
+            }
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapped);
+            return true;
+        }
+
+        const char* data = nullptr;
+        size_t size = 0;
+
+    private:
+        int fd = -1;
+    };
+
+    // Разбор файла маршрутов: для каждой строки с остановками вызывается
+    // visit(троллейбус, остановки). Слова - ссылки в буфер файла, вектор
+    // остановок переиспользуется, поэтому на слово память не выделяется
+    template <typename Visit>
+    void forEachRouteLine(const char* data, size_t size, Visit visit) {
+        const char* position = data;
+        const char* end = data + size;
+        vector<string_view> words;
+        while (position < end) {
+            words.clear();
+            while (position < end && *position != '\n') {
+                char c = *position;
+                if (c == '#') {
+                    while (position < end && *position != '\n') {
+                        position++;
+                    }
+                    break;
+                }
+                if (c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r') {
+                    position++;
+                    continue;
+                }
+                const char* start = position;
+                while (position < end && *position != '\n' && *position != ' ' && *position != '\t'
+                       && *position != ',' && *position != ';' && *position != '\r' && *position != '#') {
+                    position++;
+                }
+                words.emplace_back(start, static_cast<size_t>(position - start));
+            }
+            position++;  // Перевод строки
+            if (words.size() >= 2) {
+                visit(words);
+            }
+        }
+    }
+
+    // Номер названия при загрузке: поиск по ссылке в буфер файла, новое
+    // название получает следующий номер
+    int internView(unordered_map<string_view, int>& ids, vector<string_view>& names, string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        ids.emplace(name, static_cast<int>(names.size()));
+        names.push_back(name);
+        return static_cast<int>(names.size()) - 1;
+    }
+
+    // Загрузка в пустое хранилище: номера, маршруты и все индексы строятся
+    // за один проход по данным, без поэлементных вставок в упорядоченные списки
+    size_t bulkLoad(const char* data, size_t size) {
+        unordered_map<string_view, int> trolleyLookup;
+        unordered_map<string_view, int> stopLookup;
+        vector<string_view> trolleyViews;
+        vector<string_view> stopViews;
+        vector<vector<int>> trolleyRoutes;
+        size_t routes = 0;
+        stopLookup.reserve(size / 32);
+
+        forEachRouteLine(data, size, [&](const vector<string_view>& words) {
+            int trolley = internView(trolleyLookup, trolleyViews, words[0]);
+            if (trolley == static_cast<int>(trolleyRoutes.size())) {
+                trolleyRoutes.emplace_back();
+            }
+            // Повторная строка троллейбуса заменяет маршрут, как CREATE_TRL
+            auto& route = trolleyRoutes[trolley];
+            route.clear();
+            for (size_t i = 1; i < words.size(); ++i) {
+                route.push_back(internView(stopLookup, stopViews, words[i]));
+            }
+            routes++;
+        });
+
+        // Таблицы названий: номера совпадают с номерами при разборе
+        for (string_view name : trolleyViews) {
+            trolleyNames.intern(string(name));
+        }
+        for (string_view name : stopViews) {
+            stopNames.intern(string(name));
+        }
+        size_t trolleyCount = trolleyViews.size();
+        size_t stopCount = stopViews.size();
+
+        // Троллейбусы по названию
+        vector<int>& trolleysByName = edit(network.trolleysByName);
+        trolleysByName.resize(trolleyCount);
+        for (size_t i = 0; i < trolleysByName.size(); ++i) {
+            trolleysByName[i] = static_cast<int>(i);
+        }
+        sort(trolleysByName.begin(), trolleysByName.end(), trolleyNameLess);
+
+        // Остановка - троллейбусы: обход троллейбусов по названию сразу дает
+        // упорядоченные списки; размеры считаются заранее
+        vector<int> perStop(stopCount, 0);
+        for (const auto& route : trolleyRoutes) {
+            for (int stop : route) {
+                perStop[stop]++;
+            }
+        }
+        vector<vector<int>> stopToTrolleys(stopCount);
+        for (size_t stop = 0; stop < stopCount; ++stop) {
+            stopToTrolleys[stop].reserve(perStop[stop]);
+        }
+        for (int trolley : trolleysByName) {
+            for (int stop : trolleyRoutes[trolley]) {
+                auto& trolleys = stopToTrolleys[stop];
+                if (trolleys.empty() || trolleys.back() != trolley) {
+                    trolleys.push_back(trolley);
+                }
+            }
+        }
+
+        // Индекс пересадок: троллейбусы независимы, поэтому строятся
+        // параллельно; остановки упорядочиваются по заранее найденному рангу названия
+        vector<int> stopOrder(stopCount);
+        for (size_t i = 0; i < stopOrder.size(); ++i) {
+            stopOrder[i] = static_cast<int>(i);
+        }
+        sort(stopOrder.begin(), stopOrder.end(), stopNameLess);
+        vector<int> stopRank(stopCount);
+        for (size_t i = 0; i < stopOrder.size(); ++i) {
+            stopRank[stopOrder[i]] = static_cast<int>(i);
+        }
+
+        vector<vector<Transfer>> transfers(trolleyCount);
+        auto buildTransfers = [&](size_t first, size_t last) {
+            vector<int> stops;
+            for (size_t trolley = first; trolley < last; ++trolley) {
+                stops = trolleyRoutes[trolley];
+                sort(stops.begin(), stops.end(), [&](int a, int b) { return stopRank[a] < stopRank[b]; });
+                stops.erase(unique(stops.begin(), stops.end()), stops.end());
+                transfers[trolley].reserve(stops.size());
+                for (int stop : stops) {
+                    const auto& trolleys = stopToTrolleys[stop];
+                    if (trolleys.size() < 2) {
+                        continue;
+                    }
+                    Transfer transfer{stop, {}};
+                    transfer.trolleys.reserve(trolleys.size() - 1);
+                    for (int other : trolleys) {
+                        if (other != static_cast<int>(trolley)) {
+                            transfer.trolleys.push_back(other);
+                        }
+                    }
+                    transfers[trolley].push_back(move(transfer));
+                }
+            }
+        };
+        size_t threads = min<size_t>(max(1u, thread::hardware_concurrency()), trolleyCount / 256 + 1);
+        vector<thread> workers;
+        for (size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(buildTransfers, trolleyCount * t / threads, trolleyCount * (t + 1) / threads);
+        }
+        buildTransfers(0, trolleyCount / threads);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        // Списки текущей версии
+        for (size_t trolley = 0; trolley < trolleyCount; ++trolley) {
+            network.trolleyRoutes.push_back(make_shared<vector<int>>(move(trolleyRoutes[trolley])));
+            network.transfers.push_back(make_shared<vector<Transfer>>(move(transfers[trolley])));
+        }
+        for (auto& trolleys : stopToTrolleys) {
+            network.stopToTrolleys.push_back(make_shared<vector<int>>(move(trolleys)));
+        }
+
+        transferGraphDirty = true;
+        return routes;
+    }
+}
+
+// Загрузка маршрутов из файла
+bool loadRoutes(const string& path, LoadResult& result) {
+    MappedFile file;
+    if (!file.open(path)) {
+        result.error = "cannot read file " + path;
+        return false;
+    }
+
+    // Пустое хранилище не очищается: таблицы названий могут читать снимки
+    if (trolleyNames.size() == 0 && stopNames.size() == 0) {
+        result.routes = bulkLoad(file.data, file.size);
+    } else {
+        // Хранилище не пусто: маршруты добавляются по одному
+        vector<string> stops;
+        forEachRouteLine(file.data, file.size, [&](const vector<string_view>& words) {
+            stops.resize(words.size() - 1);
+            for (size_t i = 1; i < words.size(); ++i) {
+                stops[i - 1].assign(words[i].data(), words[i].size());
+            }
+            addTrolleyRoute(string(words[0]), stops);
+            result.routes++;
+        });
+    }
+    result.trolleys = trolleyNames.size();
+    result.stops = stopNames.size();
+    return true;
 }
@@ -5,10 +5,15 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <atomic>
 
 using namespace std;
 
-// Инициализация хранилища (очистка всех данных)
+// Инициализация хранилища (очистка всех данных). Снимков хранилища при
+// этом быть не должно: названия удаляются из общих таблиц
 void initializeStorage();
 
 // Добавление маршрута троллейбуса в систему
@@ -30,4 +35,165 @@ map<string, set<string>> getStopsForTrolley(const string& trolleyName);
 // возвращает map: ключ - название троллейбуса, значение - вектор остановок
 map<string, vector<string>> getAllTrolleys();
 
+// Таблица интернированных названий: номер -> название и название -> номер.
+// Названия только добавляются и не перемещаются в памяти, поэтому одну
+// таблицу разделяют все версии хранилища, а читатели обращаются к ней без
+// блокировок, пока писатель добавляет новые названия. Поиск - открытая
+// адресация; при росте строится вдвое большая таблица поиска и подменяет
+// прежнюю атомарно, прежние хранятся до clear()
+class NameTable {
+public:
+    // Название по номеру
+    const string& operator[](int id) const {
+        return index.load(memory_order_acquire)->byId[id]->name;
+    }
+
+    // Номер названия, -1 если такого названия нет
+    int find(const string& name) const;
+
+    // Номер названия; новое название получает следующий номер (только писатель)
+    int intern(const string& name);
+
+    // Количество названий (только писатель)
+    size_t size() const { return entries.size(); }
+
+    // Удаление всех названий (только когда нет читателей)
+    void clear();
+
+private:
+    struct Entry {
+        string name;
+        int id;
+    };
+    struct Index {
+        size_t mask;                               // Размер таблицы поиска - 1
+        unique_ptr<atomic<const Entry*>[]> slots;  // Таблица поиска
+        unique_ptr<const Entry*[]> byId;           // Записи по номеру
+    };
+
+    deque<Entry> entries;
+    vector<unique_ptr<Index>> indexes;  // Текущая таблица поиска - последняя
+    atomic<const Index*> index{nullptr};
+};
+
+// Список названий без копирования: ссылается на номера в хранилище и таблицу
+// названий. Действителен до следующего изменения хранилища (для снимка -
+// пока существует снимок)
+class NameList {
+public:
+    NameList() = default;
+    NameList(const vector<int>* ids, const NameTable* names) : ids(ids), names(names) {}
+
+    size_t size() const { return ids ? ids->size() : 0; }
+    bool empty() const { return size() == 0; }
+    const string& operator[](size_t i) const { return (*names)[(*ids)[i]]; }
+
+    // Итератор по названиям
+    class Iterator {
+    public:
+        Iterator(const int* id, const NameTable* names) : id(id), names(names) {}
+        const string& operator*() const { return (*names)[*id]; }
+        Iterator& operator++() { ++id; return *this; }
+        bool operator!=(const Iterator& other) const { return id != other.id; }
+    private:
+        const int* id;
+        const NameTable* names;
+    };
+
+    Iterator begin() const { return {ids ? ids->data() : nullptr, names}; }
+    Iterator end() const { return {ids ? ids->data() + ids->size() : nullptr, names}; }
+
+private:
+    const vector<int>* ids = nullptr;
+    const NameTable* names = nullptr;
+};
+
+// Версия сети маршрутов. Каждый список (маршрут троллейбуса, троллейбусы
+// остановки, пересадки троллейбуса) хранится отдельно через shared_ptr, и
+// версии разделяют неизмененные списки: копия версии копирует только
+// указатели, а изменение маршрута заменяет лишь затронутые им списки
+// (копирование при записи). Названия - в общих таблицах NameTable.
+// Текущее состояние хранилища - тоже версия: функции чтения хранилища
+// вызывают функции чтения этого класса. Неизменяемый снимок можно читать из
+// нескольких потоков без синхронизации; списки NameList действительны,
+// пока существует снимок
+class NetworkSnapshot {
+public:
+    // Пересадка на остановке маршрута: другие троллейбусы на ней по названию
+    struct Transfer {
+        int stop;
+        vector<int> trolleys;
+    };
+
+    NameList trolleysAtStop(const string& stop) const;
+    NameList stopsOfTrolley(const string& trolleyName) const;
+    size_t trolleyCount() const { return trolleysByName->size(); }
+    void forEachTrolley(const function<void(const string&, const NameList&)>& visit) const;
+    size_t forEachTransfer(const string& trolleyName,
+                           const function<void(const string&, const NameList&)>& visit) const;
+
+    // Списки версии по номерам троллейбусов и остановок. Меняет их только
+    // писатель хранилища и только неразделенные: разделенный со снимком
+    // список сначала копируется
+    vector<shared_ptr<vector<int>>> trolleyRoutes;        // Остановки маршрута
+    vector<shared_ptr<vector<int>>> stopToTrolleys;       // Троллейбусы по названию
+    vector<shared_ptr<vector<Transfer>>> transfers;       // Пересадки по названию остановки
+    shared_ptr<vector<int>> trolleysByName = make_shared<vector<int>>();
+};
+
+// Функции чтения без копирования данных хранилища (по текущей версии)
+
+// Троллейбусы, проходящие через остановку, по алфавиту
+// (пустой список, если остановки нет)
+NameList trolleysAtStop(const string& stop);
+
+// Остановки маршрута троллейбуса в порядке следования
+// (пустой список, если троллейбуса нет)
+NameList stopsOfTrolley(const string& trolleyName);
+
+// Количество троллейбусов в системе
+size_t trolleyCount();
+
+// Обход всех троллейбусов по алфавиту: visit(название, остановки маршрута)
+void forEachTrolley(const function<void(const string&, const NameList&)>& visit);
+
+// Обход остановок троллейбуса, где есть пересадки, по алфавиту:
+// visit(остановка, другие троллейбусы на ней). Возвращает число таких остановок
+size_t forEachTransfer(const string& trolleyName,
+                       const function<void(const string&, const NameList&)>& visit);
+
+// Снимок текущего состояния хранилища: копия указателей на списки текущей
+// версии. Создается и удаляется писателем
+unique_ptr<NetworkSnapshot> makeSnapshot();
+
+// Участок поездки: на троллейбусе trolley от остановки from до остановки to
+struct JourneyLeg {
+    string trolley;
+    string from;
+    string to;
+    int stops;      // Количество проезжаемых перегонов
+};
+
+// Поиск поездки от остановки from до остановки to с наименьшим числом
+// пересадок, а среди таких - с наименьшим числом перегонов. Троллейбусы
+// ходят по маршруту в обе стороны. Участки поездки записываются в legs;
+// false, если остановок нет, через них не ходит ни один троллейбус или
+// между ними нет пути
+bool findJourney(const string& from, const string& to, vector<JourneyLeg>& legs);
+
+// Результат загрузки маршрутов из файла
+struct LoadResult {
+    size_t routes = 0;      // Прочитано маршрутов
+    size_t trolleys = 0;    // Троллейбусов в системе после загрузки
+    size_t stops = 0;       // Остановок в системе после загрузки
+    string error;           // Описание ошибки, если загрузка не удалась
+};
+
+// Загрузка маршрутов из файла. Каждая строка - "троллейбус остановка1 ... остановкаN"
+// (разделители - пробелы, табуляции, запятые, точки с запятой; '#' - комментарий
+// до конца строки) и действует как CREATE_TRL; строки без остановок пропускаются.
+// В пустое хранилище маршруты загружаются одним проходом с построением всех
+// индексов сразу, иначе добавляются по одному
+bool loadRoutes(const string& path, LoadResult& result);
+
 #endif // STORAGE_H
@@ -2,11 +2,12 @@
 #define TRL_IN_STOP_H
 
 #include <string>
+#include "storage.h"
 
 using namespace std;
 
 // Получение списка троллейбусов для указанной остановки
-// stop - название остановки
-void executeTrolleysInStop(const string& stop);
+// snapshot - версия хранилища, stop - название остановки
+void executeTrolleysInStop(const NetworkSnapshot& snapshot, const string& stop);
 
 #endif // TRL_IN_STOP_H
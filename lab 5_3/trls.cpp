@@ -1,26 +1,23 @@
 #include "trls.h"
-#include "storage.h"
 #include <iostream>
 
 using namespace std;
 
 // Обработка команды вывода всех троллейбусов
-void executeListAllTrolleys() {
-    // Получаем информацию о всех троллейбусах
-    auto allTrolleys = getAllTrolleys();
-    
-    // Выводим результат
-    if (allTrolleys.empty()) {
+void executeListAllTrolleys(const NetworkSnapshot& snapshot) {
+    // Выводим результат прямо из снимка, без копирования маршрутов
+    if (snapshot.trolleyCount() == 0) {
         cout << "No trolleys registered in the system." << endl;
     } else {
-        cout << "All trolleys and their routes:" << endl;
+        cout << "All trolleys and their routes:" << '\n';
         // Для каждого троллейбуса выводим его остановки
-        for (const auto& [trolley, stops] : allTrolleys) {
+        snapshot.forEachTrolley([](const string& trolley, const NameList& stops) {
             cout << "- " << trolley << ": ";
             for (const auto& stop : stops) {
                 cout << stop << " ";
             }
-            cout << endl;
-        }
+            cout << '\n';
+        });
+        cout << flush;
     }
 }
@@ -1,7 +1,10 @@
 #ifndef TRLS_H
 #define TRLS_H
 
+#include "storage.h"
+
 // Получение списка всех троллейбусов с их маршрутами
-void executeListAllTrolleys();
+// snapshot - версия хранилища
+void executeListAllTrolleys(const NetworkSnapshot& snapshot);
 
 #endif // TRLS_H
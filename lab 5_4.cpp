@@ -1,114 +1,1261 @@
 #include <iostream>
 #include <vector>
-#include <set>
 #include <string>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <climits>
+#include <map>
+#include <queue>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
-int total_students = 0;         // Общее количество студентов
-set<int> suspected;             // Множество номеров студентов в списке на отчисление
-set<int> immortal_students;              // Множество номеров неприкасаемых студентов
+// Состояние студента
+enum StudentState : uint8_t {
+    ORDINARY = 0,   // Обычный студент
+    SUSPECTED = 1,  // В списке на отчисление
+    IMMORTAL = 2    // Неприкасаемый
+};
+
+// Изменение состояний: новое состояние для каждого старого. Два изменения
+// подряд - снова изменение, поэтому на отрезке их можно откладывать
+struct StateMap {
+    uint8_t to[3];
+
+    bool keeps() const {
+        return to[ORDINARY] == ORDINARY && to[SUSPECTED] == SUSPECTED && to[IMMORTAL] == IMMORTAL;
+    }
+    // Сначала это изменение, затем next
+    StateMap then(const StateMap& next) const {
+        return {{next.to[to[0]], next.to[to[1]], next.to[to[2]]}};
+    }
+};
+
+const StateMap KEEP_STATE = {{ORDINARY, SUSPECTED, IMMORTAL}};
+const StateMap MAKE_SUSPECTED = {{SUSPECTED, SUSPECTED, IMMORTAL}};    // Неприкасаемых не трогает
+const StateMap MAKE_IMMORTAL = {{IMMORTAL, IMMORTAL, IMMORTAL}};       // Снимает и подозрение
+const StateMap CLEAR_SUSPECTED = {{ORDINARY, ORDINARY, IMMORTAL}};
+const StateMap CLEAR_IMMORTAL = {{ORDINARY, SUSPECTED, ORDINARY}};
+
+// Реестр состояний студентов: персистентное дерево отрезков над словами по
+// 64 студента. Лист - маски подозреваемых и неприкасаемых в слове, узел -
+// их количества в поддереве и отложенное изменение для детей. Изменение
+// отрезка номеров любой длины стоит O(log(n / 64)) и не трогает старые
+// узлы: путь от корня копируется, остальное поддерево общее. Каждая версия -
+// свой корень, поэтому любую прошлую версию можно читать как текущую
+struct StudentTree {
+    struct Node {
+        int left, right;        // Дети: узлы или, на высоте 1, слова
+        int suspected;          // Подозреваемых в поддереве
+        int immortal;           // Неприкасаемых в поддереве
+        StateMap pending;       // Не переданное детям изменение
+    };
+    struct Word {
+        uint64_t suspected;     // Бит x % 64 - студент x слова
+        uint64_t immortal;
+    };
+    struct Version {
+        int root = 0;           // Корень: узел или, при высоте 0, слово
+        int height = 0;         // Высота дерева; студентов 64 << height
+    };
+
+    vector<Node> nodes;
+    vector<Word> words;
+    vector<int> empty;          // [h] - общее поддерево высоты h без особых студентов
+    Version version;            // Текущая версия
+    size_t fresh_nodes = 0;     // Узлы и слова с этих номеров созданы текущим
+    size_t fresh_words = 0;     // изменением и меняются на месте
+
+    StudentTree() {
+        words.push_back({0, 0});
+        empty.push_back(0);
+    }
+
+    // Расширение до номера students включительно: новый корень над старым
+    // деревом и пустым поддеревом той же высоты
+    void grow(int students) {
+        while (static_cast<long long>(students) >= (64LL << version.height)) {
+            int suspected, immortal;
+            counts(version.root, version.height, KEEP_STATE, suspected, immortal);
+            int right = empty_subtree(version.height);
+            nodes.push_back({version.root, right, suspected, immortal, KEEP_STATE});
+            version.root = static_cast<int>(nodes.size() - 1);
+            version.height++;
+        }
+    }
+
+    // Изменение состояний студентов first..last - новая текущая версия
+    void update(int first, int last, const StateMap& change) {
+        fresh_nodes = nodes.size();
+        fresh_words = words.size();
+        version.root = update(version.root, version.height, 0, first, last, change);
+    }
+
+    int suspected_total(const Version& v) const {
+        int suspected, immortal;
+        counts(v.root, v.height, KEEP_STATE, suspected, immortal);
+        return suspected;
+    }
+    int suspected_total() const {
+        return suspected_total(version);
+    }
+
+    // Состояние студента x: изменения предков складываются по пути от
+    // корня (ближе к корню - более позднее) и применяются к листу
+    StudentState state(int x) const {
+        StateMap above = KEEP_STATE;
+        int index = version.root;
+        for (int height = version.height; height > 0; --height) {
+            const Node& node = nodes[index];
+            above = node.pending.then(above);
+            index = ((x >> (5 + height)) & 1) ? node.right : node.left;
+        }
+        uint64_t bit = uint64_t(1) << (x & 63);
+        uint8_t result = ORDINARY;
+        if (words[index].suspected & bit) {
+            result = SUSPECTED;
+        } else if (words[index].immortal & bit) {
+            result = IMMORTAL;
+        }
+        return static_cast<StudentState>(above.to[result]);
+    }
+
+    // Количество подозреваемых с номерами 1..x: спуск к листу x
+    int suspected_up_to(int x) const {
+        StateMap above = KEEP_STATE;
+        int count = 0;
+        int index = version.root;
+        for (int height = version.height; height > 0; --height) {
+            const Node& node = nodes[index];
+            above = node.pending.then(above);
+            if ((x >> (5 + height)) & 1) {
+                int suspected, immortal;
+                counts(node.left, height - 1, above, suspected, immortal);
+                count += suspected;
+                index = node.right;
+            } else {
+                index = node.left;
+            }
+        }
+        uint64_t tail = mapped(words[index], above).suspected & (~uint64_t(0) >> (63 - (x & 63)));
+        return count + __builtin_popcountll(tail);
+    }
+
+    // Номер k-го по возрастанию подозреваемого (k от 1 до suspected_total())
+    int kth_suspected(int k) const {
+        StateMap above = KEEP_STATE;
+        int index = version.root;
+        long long first = 0;
+        for (int height = version.height; height > 0; --height) {
+            const Node& node = nodes[index];
+            above = node.pending.then(above);
+            int suspected, immortal;
+            counts(node.left, height - 1, above, suspected, immortal);
+            if (k <= suspected) {
+                index = node.left;
+            } else {
+                k -= suspected;
+                index = node.right;
+                first += 32LL << height;
+            }
+        }
+        uint64_t word = mapped(words[index], above).suspected;
+        while (--k > 0) {
+            word &= word - 1;
+        }
+        return static_cast<int>(first + __builtin_ctzll(word));
+    }
+
+    // Обход подозреваемых версии v по возрастанию номера: первые skip
+    // пропускаются по счетчикам поддеревьев, обход останавливается после
+    // limit студентов
+    template <typename Visit>
+    void for_each_suspected(const Version& v, Visit visit, int skip = 0, int limit = INT_MAX) const {
+        if (limit > 0) {
+            for_each_suspected(v.root, v.height, 0, KEEP_STATE, skip, limit, visit);
+        }
+    }
+    template <typename Visit>
+    void for_each_suspected(Visit visit, int skip = 0, int limit = INT_MAX) const {
+        for_each_suspected(version, visit, skip, limit);
+    }
+
+private:
+    int empty_subtree(int height) {
+        while (static_cast<int>(empty.size()) <= height) {
+            int child = empty.back();
+            nodes.push_back({child, child, 0, 0, KEEP_STATE});
+            empty.push_back(static_cast<int>(nodes.size() - 1));
+        }
+        return empty[height];
+    }
+
+    // Слово после изменения change студентов из mask
+    static Word mapped(const Word& word, const StateMap& change, uint64_t mask = ~uint64_t(0)) {
+        uint64_t by_state[3];
+        by_state[SUSPECTED] = word.suspected & mask;
+        by_state[IMMORTAL] = word.immortal & mask;
+        by_state[ORDINARY] = mask & ~by_state[SUSPECTED] & ~by_state[IMMORTAL];
+        uint64_t to_state[3] = {0, 0, 0};
+        for (int s = 0; s < 3; ++s) {
+            to_state[change.to[s]] |= by_state[s];
+        }
+        return {(word.suspected & ~mask) | to_state[SUSPECTED], (word.immortal & ~mask) | to_state[IMMORTAL]};
+    }
+
+    // Количества в поддереве index высоты height после изменения above
+    void counts(int index, int height, const StateMap& above, int& suspected, int& immortal) const {
+        if (height == 0) {
+            Word word = mapped(words[index], above);
+            suspected = __builtin_popcountll(word.suspected);
+            immortal = __builtin_popcountll(word.immortal);
+            return;
+        }
+        long long by_state[3];
+        by_state[SUSPECTED] = nodes[index].suspected;
+        by_state[IMMORTAL] = nodes[index].immortal;
+        by_state[ORDINARY] = (64LL << height) - by_state[SUSPECTED] - by_state[IMMORTAL];
+        long long to_state[3] = {0, 0, 0};
+        for (int s = 0; s < 3; ++s) {
+            to_state[above.to[s]] += by_state[s];
+        }
+        suspected = static_cast<int>(to_state[SUSPECTED]);
+        immortal = static_cast<int>(to_state[IMMORTAL]);
+    }
+
+    // Изменение студентов из mask в слове; старое слово не меняется,
+    // если оно общее со старыми версиями
+    int apply_word(int index, const StateMap& change, uint64_t mask) {
+        Word word = mapped(words[index], change, mask);
+        if (word.suspected == words[index].suspected && word.immortal == words[index].immortal) {
+            return index;
+        }
+        if (static_cast<size_t>(index) < fresh_words) {
+            words.push_back(word);
+            return static_cast<int>(words.size() - 1);
+        }
+        words[index] = word;
+        return index;
+    }
+
+    // Копия узла для изменения (узел текущего изменения меняется на месте)
+    int own_node(int index) {
+        if (static_cast<size_t>(index) < fresh_nodes) {
+            nodes.push_back(nodes[index]);
+            return static_cast<int>(nodes.size() - 1);
+        }
+        return index;
+    }
+
+    // Изменение всего поддерева: количества пересчитываются сразу,
+    // детям изменение передается позже
+    int apply(int index, int height, const StateMap& change) {
+        if (height == 0) {
+            return apply_word(index, change, ~uint64_t(0));
+        }
+        int node = own_node(index);
+        int suspected, immortal;
+        counts(node, height, change, suspected, immortal);
+        nodes[node].suspected = suspected;
+        nodes[node].immortal = immortal;
+        nodes[node].pending = nodes[node].pending.then(change);
+        return node;
+    }
+
+    // Передача отложенного изменения узла детям
+    void push(int node, int height) {
+        StateMap change = nodes[node].pending;
+        if (!change.keeps()) {
+            int left = apply(nodes[node].left, height - 1, change);
+            nodes[node].left = left;
+            int right = apply(nodes[node].right, height - 1, change);
+            nodes[node].right = right;
+            nodes[node].pending = KEEP_STATE;
+        }
+    }
+
+    void pull(int node, int height) {
+        int left_suspected, left_immortal, right_suspected, right_immortal;
+        counts(nodes[node].left, height - 1, KEEP_STATE, left_suspected, left_immortal);
+        counts(nodes[node].right, height - 1, KEEP_STATE, right_suspected, right_immortal);
+        nodes[node].suspected = left_suspected + right_suspected;
+        nodes[node].immortal = left_immortal + right_immortal;
+    }
+
+    // Изменение студентов first..last в поддереве index высоты height,
+    // начинающемся со студента begin; результат - корень нового поддерева
+    int update(int index, int height, long long begin, int first, int last, const StateMap& change) {
+        long long end = begin + (64LL << height) - 1;
+        if (last < begin || first > end) {
+            return index;
+        }
+        if (height == 0) {
+            // Часть слова: маска битов from..to
+            int from = static_cast<int>(max<long long>(first, begin) - begin);
+            int to = static_cast<int>(min<long long>(last, end) - begin);
+            uint64_t mask = (~uint64_t(0) >> (63 - to)) & (~uint64_t(0) << from);
+            return apply_word(index, change, mask);
+        }
+        if (first <= begin && end <= last) {
+            return apply(index, height, change);
+        }
+        int node = own_node(index);
+        push(node, height);
+        long long middle = begin + (32LL << height);
+        int left = update(nodes[node].left, height - 1, begin, first, last, change);
+        nodes[node].left = left;
+        int right = update(nodes[node].right, height - 1, middle, first, last, change);
+        nodes[node].right = right;
+        pull(node, height);
+        return node;
+    }
+
+    template <typename Visit>
+    void for_each_suspected(int index, int height, long long begin, const StateMap& above,
+                            int& skip, int& limit, Visit& visit) const {
+        int suspected, immortal;
+        counts(index, height, above, suspected, immortal);
+        if (suspected <= skip) {
+            skip -= suspected;
+            return;
+        }
+        if (height == 0) {
+            // Установленные биты слова по порядку: ctz дает младший бит
+            uint64_t word = mapped(words[index], above).suspected;
+            for (; skip > 0; --skip) {
+                word &= word - 1;
+            }
+            while (word != 0 && limit > 0) {
+                visit(static_cast<int>(begin + __builtin_ctzll(word)));
+                word &= word - 1;
+                --limit;
+            }
+            return;
+        }
+        StateMap below = nodes[index].pending.then(above);
+        for_each_suspected(nodes[index].left, height - 1, begin, below, skip, limit, visit);
+        if (limit > 0) {
+            for_each_suspected(nodes[index].right, height - 1, begin + (32LL << height), below, skip, limit, visit);
+        }
+    }
+};
+
+// Буфер вывода в поток stdio: строки копятся в буфере и уходят одной
+// записью. В обычном режиме буфер сбрасывается после каждой команды, в
+// быстром - только при заполнении и в конце работы. Если задана строка
+// capture, вывод копится в ней вместо потока (вывод факультета в пуле)
+struct OutputBuffer {
+    static const size_t SIZE = 1 << 16;
+    FILE* stream;
+    string* capture = nullptr;
+    char data[SIZE];
+    size_t size = 0;
+
+    explicit OutputBuffer(FILE* stream) : stream(stream) {}
+
+    void write(const char* bytes, size_t length) {
+        if (capture != nullptr) {
+            capture->append(bytes, length);
+        } else {
+            fwrite(bytes, 1, length, stream);
+        }
+    }
+    void flush() {
+        if (size > 0) {
+            write(data, size);
+            size = 0;
+        }
+        if (capture == nullptr) {
+            fflush(stream);
+        }
+    }
+    void put(const char* text, size_t length) {
+        if (size + length > SIZE) {
+            write(data, size);
+            size = 0;
+            if (length > SIZE) {
+                write(text, length);
+                return;
+            }
+        }
+        memcpy(data + size, text, length);
+        size += length;
+    }
+    void put(const char* text) {
+        put(text, strlen(text));
+    }
+    void put_number(long long value) {
+        char digits[24];
+        size_t length = 0;
+        unsigned long long rest = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+        do {
+            digits[sizeof(digits) - 1 - length++] = static_cast<char>('0' + rest % 10);
+            rest /= 10;
+        } while (rest != 0);
+        if (value < 0) {
+            digits[sizeof(digits) - 1 - length++] = '-';
+        }
+        put(digits + sizeof(digits) - length, length);
+    }
+};
+
+// Вывод и реестр - свои у каждого потока: в режиме факультетов поток
+// пула подменяет реестр реестром факультета, которым сейчас занят
+thread_local OutputBuffer out(stdout);      // Обычный вывод
+thread_local OutputBuffer err(stderr);      // Сообщения об ошибках
+
+thread_local int total_students = 0;        // Общее количество студентов
+thread_local StudentTree students;          // Состояния студентов
+thread_local vector<StudentTree::Version> history(1);  // [N] - версия после команды N (0 - до первой)
 
 // Обработка команды NEW_STUDENTS - добавление новых студентов
 void new_students(int number) {
     // Если число отрицательное - это удаление студентов
     if (number < 0) {
-        cerr << "GoodBye " << -number << " clever students!" << endl;
+        err.put("GoodBye ");
+        err.put_number(-static_cast<long long>(number));
+        err.put(" clever students!\n");
         return;
     }
     
-    // Увеличиваем общее количество студентов
+    // Увеличиваем общее количество студентов; дерево расширяется с запасом,
+    // чтобы рост стоил O(1) в среднем
     total_students += number;
-    cout << "Welcome " << number << " clever students!" << endl;
+    students.grow(total_students);
+    out.put("Welcome ");
+    out.put_number(number);
+    out.put(" clever students!\n");
 }
 
 // Обработка команды SUSPICIOUS - добавление студента в список на отчисление
 void suspicious(int number_student) {
     // Проверка корректности номера студента
     if (number_student <= 0 || number_student > total_students) {
-        cerr << "Incorrect" << endl;
+        err.put("Incorrect\n");
         return;
     }
     
     // Если студент неприкасаемый - игнорируем команду
-    if (immortal_students.find(number_student) != immortal_students.end()) {
+    StudentState state = students.state(number_student);
+    if (state == IMMORTAL) {
         return;
     }
     
-    // Добавляем студента в список на отчисление
-    suspected.insert(number_student);
-    cout << "The suspected student " << number_student << endl;
+    // Добавляем студента в список на отчисление (повтор не создает узлов)
+    if (state != SUSPECTED) {
+        students.update(number_student, number_student, MAKE_SUSPECTED);
+    }
+    out.put("The suspected student ");
+    out.put_number(number_student);
+    out.put("\n");
 }
 
 // Обработка команды IMMORTAL - добавление студента в список неприкасаемых
 void immortal(int number_student) {
     // Проверка корректности номера студента
     if (number_student <= 0 || number_student > total_students) {
-        cerr << "Incorrect" << endl;
+        err.put("Incorrect\n");
         return;
     }
     
-    // Удаляем студента из списка на отчисление (если он там был)
-    suspected.erase(number_student);
-    // Добавляем в список неприкасаемых
-    immortal_students.insert(number_student);
-    cout << "Student " << number_student << " is immortal!" << endl;
+    // Добавляем в список неприкасаемых (и удаляем из списка на отчисление)
+    if (students.state(number_student) != IMMORTAL) {
+        students.update(number_student, number_student, MAKE_IMMORTAL);
+    }
+    out.put("Student ");
+    out.put_number(number_student);
+    out.put(" is immortal!\n");
+}
+
+// Проверка отрезка номеров first..last для команд *_RANGE
+bool correct_range(int first, int last) {
+    if (first <= 0 || first > last || last > total_students) {
+        err.put("Incorrect\n");
+        return false;
+    }
+    return true;
+}
+
+// Обработка команды SUSPICIOUS_RANGE - студенты first..last в список на
+// отчисление; неприкасаемые среди них остаются неприкасаемыми
+void suspicious_range(int first, int last) {
+    if (!correct_range(first, last)) {
+        return;
+    }
+    students.update(first, last, MAKE_SUSPECTED);
+    out.put("The suspected students from ");
+    out.put_number(first);
+    out.put(" to ");
+    out.put_number(last);
+    out.put("\n");
+}
+
+// Обработка команды IMMORTAL_RANGE - студенты first..last неприкасаемые
+void immortal_range(int first, int last) {
+    if (!correct_range(first, last)) {
+        return;
+    }
+    students.update(first, last, MAKE_IMMORTAL);
+    out.put("Students from ");
+    out.put_number(first);
+    out.put(" to ");
+    out.put_number(last);
+    out.put(" are immortal!\n");
 }
 
-// Обработка команды TOP-LIST - вывод списка студентов на отчисление
-void top_list() {
-    cout << "List of students for expulsion:";
+// Обработка команды CLEAR_SUSPICIOUS_RANGE - студенты first..last
+// удаляются из списка на отчисление
+void clear_suspicious_range(int first, int last) {
+    if (!correct_range(first, last)) {
+        return;
+    }
+    students.update(first, last, CLEAR_SUSPECTED);
+    out.put("Students from ");
+    out.put_number(first);
+    out.put(" to ");
+    out.put_number(last);
+    out.put(" are no longer suspected\n");
+}
+
+// Обработка команды CLEAR_IMMORTAL_RANGE - студенты first..last
+// становятся обычными
+void clear_immortal_range(int first, int last) {
+    if (!correct_range(first, last)) {
+        return;
+    }
+    students.update(first, last, CLEAR_IMMORTAL);
+    out.put("Students from ");
+    out.put_number(first);
+    out.put(" to ");
+    out.put_number(last);
+    out.put(" are no longer immortal\n");
+}
+
+// Обработка команды TOP-LIST - вывод списка студентов на отчисление в
+// версии version. Длинный список уходит в поток частями по мере заполнения
+// буфера вывода
+void top_list(int offset = 0, int limit = INT_MAX, const StudentTree::Version& version = students.version) {
+    out.put("List of students for expulsion:");
     bool first = true;  // Флаг для обработки первой записи (чтобы не ставить запятую перед ней)
     
-    // Перебираем всех студентов в списке на отчисление
-    for (int num : suspected) {
-        if (first) {
-            cout << " Student " << num;
-            first = false;
-        } else {
-            cout << ", Student " << num;
-        }
+    // Обходим дерево по возрастанию номера, пропуская поддеревья без подозреваемых
+    students.for_each_suspected(version, [&](int num) {
+        out.put(first ? " Student " : ", Student ");
+        out.put_number(num);
+        first = false;
+    }, offset, limit);
+    out.put("\n");
+}
+
+// Обработка команды TOP-LIST-PAGE - страница списка на отчисление:
+// limit студентов после первых offset, за O(log n + limit)
+void top_list_page(int offset, int limit) {
+    if (offset < 0 || limit < 0) {
+        err.put("Incorrect\n");
+        return;
+    }
+    top_list(offset, limit);
+}
+
+// Обработка команды KTH-SUSPECTED - k-й по возрастанию номера студент
+// в списке на отчисление
+void kth_suspected(int k) {
+    if (k <= 0 || k > students.suspected_total()) {
+        err.put("Incorrect\n");
+        return;
     }
-    cout << endl;
+    out.put("The suspected student number ");
+    out.put_number(k);
+    out.put(" is ");
+    out.put_number(students.kth_suspected(k));
+    out.put("\n");
+}
+
+// Обработка команды SCOUNT-UP-TO - количество студентов в списке на
+// отчисление с номерами не больше x
+void scount_up_to(int x) {
+    if (x <= 0 || x > total_students) {
+        err.put("Incorrect\n");
+        return;
+    }
+    out.put("List of students for expulsion up to ");
+    out.put_number(x);
+    out.put(" consists of ");
+    out.put_number(students.suspected_up_to(x));
+    out.put(" students\n");
 }
 
 // Обработка команды SCOUNT - вывод количества студентов в списке на отчисление
-void scount() {
-    cout << "List of students for expulsion consists of " << suspected.size() << " students" << endl;
+void scount(const StudentTree::Version& version = students.version) {
+    out.put("List of students for expulsion consists of ");
+    out.put_number(students.suspected_total(version));
+    out.put(" students\n");
 }
 
-int main() {
+// Команды реестра
+enum CommandType : uint8_t {
+    COMMAND_NEW_STUDENTS,
+    COMMAND_SUSPICIOUS,
+    COMMAND_IMMORTAL,
+    COMMAND_SUSPICIOUS_RANGE,
+    COMMAND_IMMORTAL_RANGE,
+    COMMAND_CLEAR_SUSPICIOUS_RANGE,
+    COMMAND_CLEAR_IMMORTAL_RANGE,
+    COMMAND_TOP_LIST,
+    COMMAND_SCOUNT,
+    COMMAND_TOP_LIST_PAGE,
+    COMMAND_KTH_SUSPECTED,
+    COMMAND_SCOUNT_UP_TO,
+    COMMAND_AS_OF,
+    COMMAND_UNKNOWN
+};
+
+struct CommandInfo {
+    const char* name;
+    size_t length;
+    CommandType type;
+    int arguments;      // Количество чисел после имени
+};
+
+const CommandInfo COMMANDS[] = {
+    {"NEW_STUDENTS", 12, COMMAND_NEW_STUDENTS, 1},
+    {"SUSPICIOUS", 10, COMMAND_SUSPICIOUS, 1},
+    {"IMMORTAL", 8, COMMAND_IMMORTAL, 1},
+    {"SUSPICIOUS_RANGE", 16, COMMAND_SUSPICIOUS_RANGE, 2},
+    {"IMMORTAL_RANGE", 14, COMMAND_IMMORTAL_RANGE, 2},
+    {"CLEAR_SUSPICIOUS_RANGE", 22, COMMAND_CLEAR_SUSPICIOUS_RANGE, 2},
+    {"CLEAR_IMMORTAL_RANGE", 20, COMMAND_CLEAR_IMMORTAL_RANGE, 2},
+    {"TOP-LIST", 8, COMMAND_TOP_LIST, 0},
+    {"SCOUNT", 6, COMMAND_SCOUNT, 0},
+    {"TOP-LIST-PAGE", 13, COMMAND_TOP_LIST_PAGE, 2},
+    {"KTH-SUSPECTED", 13, COMMAND_KTH_SUSPECTED, 1},
+    {"SCOUNT-UP-TO", 12, COMMAND_SCOUNT_UP_TO, 1},
+    {"AS_OF", 5, COMMAND_AS_OF, 1},     // После номера - имя запроса
+};
+
+CommandType command_type(const char* word, size_t length) {
+    for (const CommandInfo& info : COMMANDS) {
+        if (info.length == length && memcmp(info.name, word, length) == 0) {
+            return info.type;
+        }
+    }
+    return COMMAND_UNKNOWN;
+}
+
+// Разобранная команда
+struct Command {
+    CommandType type = COMMAND_UNKNOWN;
+    long long first = 0;                // Аргументы
+    long long second = 0;
+    CommandType query = COMMAND_UNKNOWN;    // Запрос AS_OF
+};
+
+// Обработка команды AS_OF N - команда TOP-LIST или SCOUNT для версии
+// реестра после команды номер N (0 - до первой команды)
+void as_of(long long number, CommandType query) {
+    if (number < 0 || number >= static_cast<long long>(history.size())) {
+        err.put("Incorrect\n");
+        return;
+    }
+    const StudentTree::Version& version = history[number];
+    if (query == COMMAND_TOP_LIST) {
+        top_list(0, INT_MAX, version);
+    }
+    else if (query == COMMAND_SCOUNT) {
+        scount(version);
+    }
+    else {
+        err.put("Incorrect\n");
+    }
+}
+
+// Выполнение команды; после каждой команды запоминается версия реестра
+void execute(const Command& command) {
+    int first = static_cast<int>(command.first);
+    int second = static_cast<int>(command.second);
+    switch (command.type) {
+    case COMMAND_NEW_STUDENTS: new_students(first); break;
+    case COMMAND_SUSPICIOUS: suspicious(first); break;
+    case COMMAND_IMMORTAL: immortal(first); break;
+    case COMMAND_SUSPICIOUS_RANGE: suspicious_range(first, second); break;
+    case COMMAND_IMMORTAL_RANGE: immortal_range(first, second); break;
+    case COMMAND_CLEAR_SUSPICIOUS_RANGE: clear_suspicious_range(first, second); break;
+    case COMMAND_CLEAR_IMMORTAL_RANGE: clear_immortal_range(first, second); break;
+    case COMMAND_TOP_LIST: top_list(); break;
+    case COMMAND_SCOUNT: scount(); break;
+    case COMMAND_TOP_LIST_PAGE: top_list_page(first, second); break;
+    case COMMAND_KTH_SUSPECTED: kth_suspected(first); break;
+    case COMMAND_SCOUNT_UP_TO: scount_up_to(first); break;
+    case COMMAND_AS_OF: as_of(command.first, command.query); break;
+    case COMMAND_UNKNOWN: break;
+    }
+    history.push_back(students.version);
+}
+
+// Сброс реестра (для повторных прогонов бенчмарка)
+void reset_registry() {
+    total_students = 0;
+    students = StudentTree();
+    history.assign(1, students.version);
+}
+
+// Чтение слов и чисел из потока istream с тем же интерфейсом, что у InputReader
+struct StreamReader {
+    istream& in;
+
+    explicit StreamReader(istream& in) : in(in) {}
+
+    size_t word(char* word, size_t capacity) {
+        string text;
+        in >> text;
+        size_t length = min(text.size(), capacity - 1);
+        memcpy(word, text.data(), length);
+        word[length] = '\0';
+        return length;
+    }
+    long long number() {
+        long long value = 0;
+        in >> value;
+        return value;
+    }
+};
+
+// Чтение ввода блоками с разбором слов и чисел прямо в буфере
+struct InputReader {
+    static const size_t SIZE = 1 << 16;
+    FILE* stream;
+    char data[SIZE];
+    size_t size = 0;
+    size_t pos = 0;
+
+    explicit InputReader(FILE* stream) : stream(stream) {}
+
+    // Следующий символ или EOF
+    int get() {
+        if (pos == size) {
+            size = fread(data, 1, SIZE, stream);
+            pos = 0;
+            if (size == 0) {
+                return EOF;
+            }
+        }
+        return static_cast<unsigned char>(data[pos++]);
+    }
+
+    // Первый символ следующего слова (пробелы пропускаются) или EOF
+    int skip_spaces() {
+        int c = get();
+        while (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            c = get();
+        }
+        return c;
+    }
+
+    // Слово в word (не длиннее capacity - 1, остаток отбрасывается); длина или 0 в конце ввода
+    size_t word(char* word, size_t capacity) {
+        int c = skip_spaces();
+        size_t length = 0;
+        while (c != EOF && c != ' ' && c != '\n' && c != '\r' && c != '\t') {
+            if (length + 1 < capacity) {
+                word[length++] = static_cast<char>(c);
+            }
+            c = get();
+        }
+        word[length] = '\0';
+        return length;
+    }
+
+    // Целое число со знаком; 0, если числа нет
+    long long number() {
+        int c = skip_spaces();
+        bool negative = c == '-';
+        if (negative || c == '+') {
+            c = get();
+        }
+        long long value = 0;
+        while (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            c = get();
+        }
+        return negative ? -value : value;
+    }
+};
+
+// Чтение команды: имя, затем столько чисел, сколько ей нужно;
+// false в конце ввода
+template <typename Reader>
+bool read_command(Reader& in, Command& command) {
+    char word[32];
+    size_t length = in.word(word, sizeof(word));
+    if (length == 0) {
+        return false;
+    }
+    command = Command();
+    command.type = command_type(word, length);
+    if (command.type == COMMAND_UNKNOWN) {
+        return true;
+    }
+    int arguments = COMMANDS[command.type].arguments;
+    if (arguments > 0) {
+        command.first = in.number();
+    }
+    if (arguments > 1) {
+        command.second = in.number();
+    }
+    if (command.type == COMMAND_AS_OF) {
+        length = in.word(word, sizeof(word));
+        command.query = command_type(word, length);
+    }
+    return true;
+}
+
+// Обработка команд из потока: строка на каждое слово команды, вывод
+// сбрасывается после каждой команды, как раньше с endl
+void process_commands(istream& in) {
     int n;  // Количество команд
-    cin >> n;
+    in >> n;
     
     // Обработка всех команд
-    for (int i = 0; i < n; ++i) {
-        string command;
-        cin >> command;
-        
-        if (command == "NEW_STUDENTS") {
-            int number;
-            cin >> number;
-            new_students(number);
+    StreamReader reader(in);
+    Command command;
+    for (int i = 0; i < n && read_command(reader, command); ++i) {
+        execute(command);
+        out.flush();
+        err.flush();
+    }
+}
+
+// Быстрый режим: ввод читается блоками, команда распознается по слову в
+// буфере без создания строки, вывод копится и сбрасывается крупными блоками.
+// Обычный вывод и ошибки по-прежнему идут в stdout и stderr
+void process_commands_fast(FILE* stream) {
+    InputReader in(stream);
+    long long n = in.number();
+    Command command;
+    for (long long i = 0; i < n && read_command(in, command); ++i) {
+        execute(command);
+    }
+    out.flush();
+    err.flush();
+}
+
+// Реестр факультета: пока команды факультета выполняются, его состояние
+// меняется местами с реестром потока (total_students, students, history)
+struct Faculty {
+    int total_students = 0;
+    StudentTree students;
+    vector<StudentTree::Version> history = vector<StudentTree::Version>(1);
+    string output;              // Вывод команд текущего отрезка журнала
+    string errors;
+    vector<size_t> commands;    // Команды факультета в текущем отрезке
+};
+
+void swap_registry(Faculty& faculty) {
+    swap(total_students, faculty.total_students);
+    swap(students, faculty.students);
+    swap(history, faculty.history);
+}
+
+// Команда факультета в отрезке журнала и границы ее вывода в
+// output и errors факультета
+struct FacultyCommand {
+    Faculty* faculty;
+    Command command;
+    size_t output_begin = 0, output_end = 0;
+    size_t errors_begin = 0, errors_end = 0;
+};
+
+// Пул потоков для отрезков журнала: потоки создаются один раз на весь
+// журнал и между отрезками ждут на условной переменной. run(job) будит их,
+// выполняет job и в вызывающем потоке и возвращается, когда job закончили
+// все потоки пула
+class SegmentPool {
+public:
+    explicit SegmentPool(int num_threads) {
+        for (int t = 1; t < num_threads; ++t) {
+            workers.emplace_back([this] { work(); });
         }
-        else if (command == "SUSPICIOUS") {
-            int num;
-            cin >> num;
-            suspicious(num);
+    }
+
+    ~SegmentPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
         }
-        else if (command == "IMMORTAL") {
-            int num;
-            cin >> num;
-            immortal(num);
+        wake.notify_all();
+        for (thread& worker : workers) {
+            worker.join();
         }
-        else if (command == "TOP-LIST") {
-            top_list();
+    }
+
+    // Число потоков вместе с вызывающим
+    size_t size() const { return workers.size() + 1; }
+
+    void run(const function<void()>& next_job) {
+        {
+            lock_guard<mutex> guard(lock);
+            job = &next_job;
+            running = workers.size();
+            generation++;
         }
-        else if (command == "SCOUNT") {
-            scount();
+        wake.notify_all();
+        next_job();
+        unique_lock<mutex> guard(lock);
+        done.wait(guard, [this] { return running == 0; });
+        job = nullptr;
+    }
+
+private:
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            const function<void()>* current;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                current = job;
+            }
+            (*current)();
+            lock_guard<mutex> guard(lock);
+            if (--running == 0) {
+                done.notify_one();
+            }
         }
     }
-    
+
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;    // Новый отрезок или остановка пула
+    condition_variable done;    // Все потоки пула закончили отрезок
+    const function<void()>* job = nullptr;
+    uint64_t generation = 0;    // Номер текущего отрезка
+    size_t running = 0;         // Потоков пула, еще выполняющих отрезок
+    bool stopping = false;
+};
+
+// Выполнение отрезка журнала между общими запросами: факультеты
+// независимы, поэтому их команды выполняются потоками пула, каждый
+// факультет - целиком в одном потоке. Вывод копится по факультетам
+// и печатается в порядке журнала, как при последовательной обработке
+void run_segment(vector<FacultyCommand>& segment, SegmentPool& pool) {
+    vector<Faculty*> active;
+    for (size_t i = 0; i < segment.size(); ++i) {
+        Faculty* faculty = segment[i].faculty;
+        if (faculty->commands.empty()) {
+            active.push_back(faculty);
+        }
+        faculty->commands.push_back(i);
+    }
+
+    atomic<size_t> next(0);
+    function<void()> worker = [&]() {
+        for (size_t k = next++; k < active.size(); k = next++) {
+            Faculty& faculty = *active[k];
+            swap_registry(faculty);
+            out.capture = &faculty.output;
+            err.capture = &faculty.errors;
+            for (size_t i : faculty.commands) {
+                FacultyCommand& entry = segment[i];
+                entry.output_begin = faculty.output.size();
+                entry.errors_begin = faculty.errors.size();
+                execute(entry.command);
+                out.flush();
+                err.flush();
+                entry.output_end = faculty.output.size();
+                entry.errors_end = faculty.errors.size();
+            }
+            out.capture = nullptr;
+            err.capture = nullptr;
+            swap_registry(faculty);
+            faculty.commands.clear();
+        }
+    };
+    // Вызывающий поток тоже выполняет команды: его буферы перед перехватом
+    // вывода должны быть пусты
+    out.flush();
+    err.flush();
+    if (active.size() <= 1 || pool.size() == 1) {
+        worker();
+    } else {
+        pool.run(worker);
+    }
+
+    for (const FacultyCommand& entry : segment) {
+        out.put(entry.faculty->output.data() + entry.output_begin, entry.output_end - entry.output_begin);
+        err.put(entry.faculty->errors.data() + entry.errors_begin, entry.errors_end - entry.errors_begin);
+    }
+    for (Faculty* faculty : active) {
+        faculty->output.clear();
+        faculty->errors.clear();
+    }
+    segment.clear();
+}
+
+// Общий SCOUNT: сумма счетчиков факультетов
+void all_scount(const map<long long, Faculty>& faculties) {
+    long long count = 0;
+    for (const auto& item : faculties) {
+        count += item.second.students.suspected_total();
+    }
+    out.put("List of students for expulsion consists of ");
+    out.put_number(count);
+    out.put(" students\n");
+}
+
+// Общий TOP-LIST: слияние списков факультетов по номеру студента (при
+// равных номерах - по номеру факультета); следующий студент факультета
+// находится по рангу за O(log n)
+void all_top_list(const map<long long, Faculty>& faculties) {
+    struct Cursor {
+        int student;
+        long long faculty_id;
+        const Faculty* faculty;
+        int rank;
+        bool operator>(const Cursor& other) const {
+            return student != other.student ? student > other.student : faculty_id > other.faculty_id;
+        }
+    };
+    priority_queue<Cursor, vector<Cursor>, greater<Cursor>> heap;
+    for (const auto& item : faculties) {
+        if (item.second.students.suspected_total() > 0) {
+            heap.push({item.second.students.kth_suspected(1), item.first, &item.second, 1});
+        }
+    }
+    out.put("List of students for expulsion:");
+    bool first = true;
+    while (!heap.empty()) {
+        Cursor cursor = heap.top();
+        heap.pop();
+        out.put(first ? " Student " : ", Student ");
+        out.put_number(cursor.student);
+        out.put(" (faculty ");
+        out.put_number(cursor.faculty_id);
+        out.put(")");
+        first = false;
+        if (cursor.rank < cursor.faculty->students.suspected_total()) {
+            cursor.rank++;
+            cursor.student = cursor.faculty->students.kth_suspected(cursor.rank);
+            heap.push(cursor);
+        }
+    }
+    out.put("\n");
+}
+
+// Журнал нескольких факультетов: после числа команд каждая строка
+// начинается с номера факультета, затем обычная команда. Строки
+// "ALL SCOUNT" и "ALL TOP-LIST" - запросы по всем факультетам сразу
+void process_faculties(FILE* stream, int threads) {
+    InputReader in(stream);
+    long long n = in.number();
+    map<long long, Faculty> faculties;
+    vector<FacultyCommand> segment;
+    SegmentPool pool(max(threads, 1));
+    char word[32];
+    for (long long i = 0; i < n; ++i) {
+        size_t length = in.word(word, sizeof(word));
+        if (length == 0) {
+            break;
+        }
+        if (strcmp(word, "ALL") == 0) {
+            // Общий запрос видит результат всех предыдущих команд
+            run_segment(segment, pool);
+            length = in.word(word, sizeof(word));
+            CommandType query = command_type(word, length);
+            if (query == COMMAND_SCOUNT) {
+                all_scount(faculties);
+            }
+            else if (query == COMMAND_TOP_LIST) {
+                all_top_list(faculties);
+            }
+            else {
+                err.put("Incorrect\n");
+            }
+            continue;
+        }
+        long long id = strtoll(word, nullptr, 10);
+        Faculty& faculty = faculties[id];
+        FacultyCommand entry;
+        entry.faculty = &faculty;
+        if (!read_command(in, entry.command)) {
+            break;
+        }
+        segment.push_back(entry);
+    }
+    run_segment(segment, pool);
+    out.flush();
+    err.flush();
+}
+
+// Сравнение обычного и быстрого режимов на журнале из commands команд.
+// Журнал пишется во временный файл, вывод уходит в /dev/null
+void run_benchmark(long long commands) {
+    const char* path = "students_bench.txt";
+    mt19937 rng(42);
+    const int STUDENTS = 1000000;
+    {
+        ofstream log(path);
+        log << commands << '\n' << "NEW_STUDENTS " << STUDENTS << '\n';
+        for (long long i = 1; i < commands; ++i) {
+            unsigned r = rng() % 1000000;
+            // Около 5% номеров - вне диапазона (ошибки в stderr)
+            int student = static_cast<int>(rng() % (STUDENTS + STUDENTS / 20)) + 1;
+            if (r < 500000) {
+                log << "SUSPICIOUS " << student << '\n';
+            } else if (r < 700000) {
+                log << "IMMORTAL " << student << '\n';
+            } else if (r < 999999) {
+                log << "SCOUNT\n";
+            } else {
+                log << "TOP-LIST\n";
+            }
+        }
+    }
+
+    FILE* null_output = fopen("/dev/null", "w");
+    if (null_output == nullptr) {
+        remove(path);
+        return;
+    }
+    FILE* saved_out = out.stream;
+    FILE* saved_err = err.stream;
+    out.stream = null_output;
+    err.stream = null_output;
+
+    reset_registry();
+    auto start = chrono::steady_clock::now();
+    {
+        ifstream log(path);
+        process_commands(log);
+    }
+    double normal_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    int normal_count = students.suspected_total();
+
+    reset_registry();
+    start = chrono::steady_clock::now();
+    FILE* log = fopen(path, "r");
+    process_commands_fast(log);
+    fclose(log);
+    double fast_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    out.stream = saved_out;
+    err.stream = saved_err;
+    fclose(null_output);
+    remove(path);
+
+    cout << "Commands: " << commands << endl;
+    cout << "Normal mode: " << normal_ms << " ms" << endl;
+    cout << "Fast mode: " << fast_ms << " ms" << (normal_count == students.suspected_total() ? "" : " (results differ!)") << endl;
+}
+
+// Одинаковое ли содержимое у двух файлов
+bool same_files(const char* first, const char* second) {
+    ifstream a(first, ios::binary), b(second, ios::binary);
+    return string(istreambuf_iterator<char>(a), {}) == string(istreambuf_iterator<char>(b), {});
+}
+
+// Журнал faculties факультетов из commands команд: обработка одним потоком
+// и пулом из threads потоков, вывод обоих прогонов сравнивается
+void run_faculties_benchmark(int faculties, long long commands, int threads) {
+    const char* path = "faculties_bench.txt";
+    const char* outputs[2] = {"faculties_bench_1.out", "faculties_bench_2.out"};
+    mt19937 rng(42);
+    const int STUDENTS = 100000;
+    {
+        ofstream log(path);
+        log << commands + faculties << '\n';
+        for (int f = 1; f <= faculties; ++f) {
+            log << f << " NEW_STUDENTS " << STUDENTS << '\n';
+        }
+        for (long long i = 0; i < commands; ++i) {
+            unsigned r = rng() % 1000000;
+            int faculty = static_cast<int>(rng() % faculties) + 1;
+            int student = static_cast<int>(rng() % STUDENTS) + 1;
+            // Общий запрос - примерно раз на 100000 команд
+            if (r < 10) {
+                log << "ALL SCOUNT\n";
+            } else if (r < 500000) {
+                log << faculty << " SUSPICIOUS " << student << '\n';
+            } else if (r < 700000) {
+                log << faculty << " IMMORTAL " << student << '\n';
+            } else if (r < 750000) {
+                log << faculty << " SUSPICIOUS_RANGE " << student << ' ' << min(student + 100, STUDENTS) << '\n';
+            } else {
+                log << faculty << " SCOUNT\n";
+            }
+        }
+        log << "ALL SCOUNT\n";
+    }
+
+    FILE* saved_out = out.stream;
+    FILE* saved_err = err.stream;
+    double elapsed[2];
+    int pool_sizes[2] = {1, threads};
+    for (int run = 0; run < 2; ++run) {
+        FILE* output = fopen(outputs[run], "w");
+        FILE* log = fopen(path, "r");
+        if (output == nullptr || log == nullptr) {
+            return;
+        }
+        out.stream = output;
+        err.stream = output;
+        auto start = chrono::steady_clock::now();
+        process_faculties(log, pool_sizes[run]);
+        elapsed[run] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        fclose(log);
+        fclose(output);
+    }
+    out.stream = saved_out;
+    err.stream = saved_err;
+    bool same = same_files(outputs[0], outputs[1]);
+    remove(path);
+    remove(outputs[0]);
+    remove(outputs[1]);
+
+    cout << "Faculties: " << faculties << ", commands: " << commands << endl;
+    cout << "1 thread: " << elapsed[0] << " ms" << endl;
+    cout << threads << " threads: " << elapsed[1] << " ms" << (same ? "" : " (results differ!)") << endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Быстрый режим: lab5_4 --fast
+    if (argc > 1 && strcmp(argv[1], "--fast") == 0) {
+        process_commands_fast(stdin);
+        return 0;
+    }
+    // Журнал нескольких факультетов: lab5_4 --faculties [потоков]
+    if (argc > 1 && strcmp(argv[1], "--faculties") == 0) {
+        int threads = argc > 2 ? atoi(argv[2]) : static_cast<int>(thread::hardware_concurrency());
+        process_faculties(stdin, threads);
+        return 0;
+    }
+    // Бенчмарк факультетов: lab5_4 --bench-faculties [факультетов] [команд] [потоков]
+    if (argc > 1 && strcmp(argv[1], "--bench-faculties") == 0) {
+        int faculties = argc > 2 ? atoi(argv[2]) : 64;
+        long long commands = argc > 3 ? atoll(argv[3]) : 5000000;
+        int threads = argc > 4 ? atoi(argv[4]) : static_cast<int>(thread::hardware_concurrency());
+        run_faculties_benchmark(max(faculties, 1), commands, max(threads, 1));
+        return 0;
+    }
+    // Бенчмарк: lab5_4 --bench [команд]
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        run_benchmark(argc > 2 ? atoll(argv[2]) : 10000000);
+        return 0;
+    }
+
+    process_commands(cin);
     return 0;
-}
\ No newline at end of file
+}